@@ -0,0 +1,434 @@
+// Synthetic RTP PCM stream generator, for testing gr-rtp without radiod
+// Sends a test tone on one or more SSRCs to a multicast group (by default on
+// the loopback interface, with TTL 0 so nothing leaves this host), with
+// optional packet loss, reordering and duplication. With --speed 0 it sends
+// as fast as it can, to find the sustained rate a flowgraph can keep up with.
+// Copyright 2023 Franco Venturi
+// based on ka9q-radio by Phil Karn, KA9Q
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <getopt.h>
+#include <poll.h>
+#include <sysexits.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "multicast.h"
+
+static char const *Default_target = "239.42.0.1:5004,lo";
+
+static struct option const Options[] = {
+  {"samprate", required_argument, NULL, 'r'},
+  {"channels", required_argument, NULL, 'c'},
+  {"type", required_argument, NULL, 'T'},
+  {"bytes", required_argument, NULL, 'b'},
+  {"streams", required_argument, NULL, 'S'},
+  {"ssrc", required_argument, NULL, 's'},
+  {"speed", required_argument, NULL, 'x'},
+  {"duration", required_argument, NULL, 'd'},
+  {"loss", required_argument, NULL, 'l'},
+  {"reorder", required_argument, NULL, 'o'},
+  {"duplicate", required_argument, NULL, 'u'},
+  {"freq", required_argument, NULL, 'f'},
+  {"ttl", required_argument, NULL, 't'},
+  {"quiet", no_argument, NULL, 'q'},
+  {"help", no_argument, NULL, 'h'},
+  {NULL, 0, NULL, 0},
+};
+static char const Optstring[] = "r:c:T:b:S:s:x:d:l:o:u:f:t:qh";
+
+// One RTP stream (SSRC)
+struct stream {
+  struct rtp_state rtp;
+  double phase;          // of the test tone, in cycles
+  uint8_t held[PKTSIZE]; // packet held back to be sent after the next one
+  int held_len;
+};
+
+// Payload sample encodings it can send
+enum encoding { S16BE, S16LE, S8, F32LE };
+
+static volatile sig_atomic_t Stop;
+
+// Statistics
+static uint64_t Sent;
+static uint64_t Lost;
+static uint64_t Reordered;
+static uint64_t Duplicated;
+static uint64_t Blocked;  // socket buffer full, had to wait
+static uint64_t Errors;
+
+static void usage(char const *name){
+  fprintf(stderr,"Usage: %s [options] [group[:port][,iface]]   (default %s)\n",name,Default_target);
+  fprintf(stderr,"  -r, --samprate HZ      sample rate (default 48000)\n");
+  fprintf(stderr,"  -c, --channels N       1 (mono) or 2 (stereo or I/Q) (default 1)\n");
+  fprintf(stderr,"  -T, --type PT          RTP payload type (default from the sample rate and channels);\n");
+  fprintf(stderr,"                         the payload is encoded as the type says: 16-bit big-endian\n");
+  fprintf(stderr,"                         (PCM and unknown types), 16-bit little-endian, 8-bit or float\n");
+  fprintf(stderr,"  -b, --bytes N          payload bytes per packet (default 960)\n");
+  fprintf(stderr,"  -S, --streams N        number of streams, with consecutive SSRCs (default 1)\n");
+  fprintf(stderr,"  -s, --ssrc N           SSRC of the first stream (default 1000)\n");
+  fprintf(stderr,"  -x, --speed X          send at X times real time, 0 = as fast as possible (default 1)\n");
+  fprintf(stderr,"  -d, --duration SEC     stop after SEC seconds of signal, 0 = never (default 0)\n");
+  fprintf(stderr,"  -l, --loss PCT         drop this percentage of the packets\n");
+  fprintf(stderr,"  -o, --reorder PCT      send this percentage of the packets after the next one\n");
+  fprintf(stderr,"  -u, --duplicate PCT    send this percentage of the packets twice\n");
+  fprintf(stderr,"  -f, --freq HZ          test tone frequency (default 1000)\n");
+  fprintf(stderr,"  -t, --ttl N            multicast TTL, 0 = this host only (default 0)\n");
+  fprintf(stderr,"  -q, --quiet            don't print the statistics\n");
+}
+
+// Encoding of payload type pt, as gr-rtp decodes it (payload_format_from_pt()),
+// and the channel count it implies in *channels (0 = not defined by the type)
+// Returns -1 for the types it can't send (12-bit packed, Opus, ...)
+static int encoding_from_pt(int pt,int *channels){
+  *channels = 0;
+  switch(pt){
+  case PCM_MONO_PT: case PCM_MONO_24_PT: case PCM_MONO_16_PT: case PCM_MONO_12_PT: case PCM_MONO_8_PT:
+    *channels = 1;
+    return S16BE;
+  case PCM_STEREO_PT: case PCM_STEREO_24_PT: case PCM_STEREO_16_PT: case PCM_STEREO_12_PT: case PCM_STEREO_8_PT:
+    *channels = 2;
+    return S16BE;
+  case PCM_MONO_LE_PT:
+  case REAL_PT:
+    *channels = 1;
+    return S16LE;
+  case PCM_STEREO_LE_PT:
+  case IQ_PT:
+    *channels = 2;
+    return S16LE;
+  case REAL_PT8:
+    *channels = 1;
+    return S8;
+  case IQ_PT8:
+    *channels = 2;
+    return S8;
+  case IQ_FLOAT:
+    *channels = 2;
+    return F32LE;
+  case REAL_PT12:
+  case IQ_PT12:
+  case AIRSPY_PACKED:
+  case AX25_PT:
+  case OPUS_PT:
+    return -1;
+  default:
+    return S16BE; // standard PCM, channels as given
+  }
+}
+
+static int sample_size(int enc){
+  return enc == S8 ? 1 : enc == F32LE ? 4 : 2;
+}
+
+// Store sample x (in [-1;1]) at dp in encoding enc; returns the next position
+static uint8_t *put_sample(uint8_t *dp,int enc,double x){
+  switch(enc){
+  case S16BE:
+  case S16LE:
+    {
+      uint16_t const s = (uint16_t)(int16_t)lrint(32767 * x);
+      *dp++ = enc == S16BE ? s >> 8 : s & 0xff;
+      *dp++ = enc == S16BE ? s & 0xff : s >> 8;
+    }
+    break;
+  case S8:
+    *dp++ = (uint8_t)(int8_t)lrint(127 * x);
+    break;
+  case F32LE:
+    {
+      float const f = x;
+      uint32_t u;
+      memcpy(&u,&f,sizeof(u));
+      for(int i=0; i < 4; i++)
+        *dp++ = u >> (8 * i);
+    }
+    break;
+  }
+  return dp;
+}
+
+static void closedown(int sig){
+  (void)sig;
+  Stop = 1;
+}
+
+static bool chance(double percent){
+  return percent > 0 && drand48() * 100 < percent;
+}
+
+static double elapsed(struct timespec const *start){
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC,&now);
+  return (now.tv_sec - start->tv_sec) + 1e-9 * (now.tv_nsec - start->tv_nsec);
+}
+
+// Send one datagram, waiting for room in the socket buffer if needed
+static void send_packet(int fd,void const *data,int len){
+  while(!Stop){
+    if(send(fd,data,len,0) == len){
+      Sent++;
+      return;
+    }
+    if(errno == EAGAIN || errno == EWOULDBLOCK){
+      // connect_mcast() makes the socket non-blocking
+      Blocked++;
+      struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+      poll(&pfd,1,100);
+      continue;
+    }
+    if(errno != EINTR){
+      if(Errors++ == 0)
+        perror("send");
+      return;
+    }
+  }
+}
+
+// Build the next packet of stream st: frames of a half scale tone at freq, in encoding enc
+// (stereo is a complex tone: cosine on the left/I channel, sine on the right/Q)
+static int make_packet(struct stream *st,uint8_t *buffer,int type,int enc,int channels,int frames,double cycles_per_frame){
+  struct rtp_header rtp;
+  memset(&rtp,0,sizeof(rtp));
+  rtp.version = RTP_VERS;
+  rtp.type = type;
+  rtp.ssrc = st->rtp.ssrc;
+  rtp.seq = st->rtp.seq++;
+  rtp.timestamp = st->rtp.timestamp;
+  st->rtp.timestamp += frames;
+  uint8_t *dp = hton_rtp(buffer,&rtp);
+
+  for(int i=0; i < frames; i++){
+    double const angle = 2 * M_PI * st->phase;
+    double const s[2] = { 0.5 * cos(angle), 0.5 * sin(angle) };
+    for(int c=0; c < channels; c++)
+      dp = put_sample(dp,enc,s[c]);
+    st->phase += cycles_per_frame;
+    st->phase -= floor(st->phase);
+  }
+  st->rtp.packets++;
+  st->rtp.bytes += dp - buffer;
+  return dp - buffer;
+}
+
+int main(int argc,char *argv[]){
+  int samprate = 48000;
+  int channels = 1;
+  int type = -1;
+  int bytes = 960;
+  int nstreams = 1;
+  uint32_t ssrc = 1000;
+  double speed = 1;
+  double duration = 0;
+  double loss = 0;
+  double reorder = 0;
+  double duplicate = 0;
+  double freq = 1000;
+  int ttl = 0;
+  bool quiet = false;
+
+  int c;
+  while((c = getopt_long(argc,argv,Optstring,Options,NULL)) != -1){
+    switch(c){
+    case 'r':
+      samprate = strtol(optarg,NULL,0);
+      break;
+    case 'c':
+      channels = strtol(optarg,NULL,0);
+      break;
+    case 'T':
+      type = strtol(optarg,NULL,0);
+      break;
+    case 'b':
+      bytes = strtol(optarg,NULL,0);
+      break;
+    case 'S':
+      nstreams = strtol(optarg,NULL,0);
+      break;
+    case 's':
+      ssrc = strtoul(optarg,NULL,0);
+      break;
+    case 'x':
+      speed = strtod(optarg,NULL);
+      break;
+    case 'd':
+      duration = strtod(optarg,NULL);
+      break;
+    case 'l':
+      loss = strtod(optarg,NULL);
+      break;
+    case 'o':
+      reorder = strtod(optarg,NULL);
+      break;
+    case 'u':
+      duplicate = strtod(optarg,NULL);
+      break;
+    case 'f':
+      freq = strtod(optarg,NULL);
+      break;
+    case 't':
+      ttl = strtol(optarg,NULL,0);
+      break;
+    case 'q':
+      quiet = true;
+      break;
+    case 'h':
+      usage(argv[0]);
+      exit(EX_OK);
+    default:
+      usage(argv[0]);
+      exit(EX_USAGE);
+    }
+  }
+  char const *target = optind < argc ? argv[optind] : Default_target;
+
+  if(samprate <= 0 || channels < 1 || channels > 2 || nstreams < 1 || speed < 0){
+    usage(argv[0]);
+    exit(EX_USAGE);
+  }
+  if(type == -1)
+    type = pt_from_info(samprate,channels);
+  int type_channels;
+  int const enc = encoding_from_pt(type,&type_channels);
+  if(enc == -1){
+    fprintf(stderr,"Can't send payload type %d\n",type);
+    exit(EX_USAGE);
+  }
+  if(type_channels != 0 && type_channels != channels){
+    fprintf(stderr,"Payload type %d has %d channel(s)\n",type,type_channels);
+    exit(EX_USAGE);
+  }
+  int const frame_size = sample_size(enc) * channels;
+  int const frames = bytes / frame_size;
+  if(frames < 1 || RTP_MIN_SIZE + frames * frame_size > PKTSIZE){
+    fprintf(stderr,"Payload size must be between %d and %d bytes\n",frame_size,PKTSIZE - RTP_MIN_SIZE);
+    exit(EX_USAGE);
+  }
+
+  // Like setup_mcast(target,...,1,ttl,...), but also send through the
+  // interface in the target (the loopback one by default)
+  struct sockaddr_storage sock;
+  char iface[IFNAMSIZ];
+  memset(&sock,0,sizeof(sock));
+  iface[0] = '\0';
+  if(resolve_mcast_tries(target,&sock,DEFAULT_RTP_PORT,iface,sizeof(iface),1) != 0){
+    fprintf(stderr,"Can't resolve %s\n",target);
+    exit(EX_NOHOST);
+  }
+  int const fd = connect_mcast(&sock,iface,ttl,0);
+  if(fd == -1){
+    fprintf(stderr,"Can't set up output to %s\n",target);
+    exit(EX_IOERR);
+  }
+  if(strlen(iface) > 0){
+    int const ifindex = if_nametoindex(iface);
+    if(sock.ss_family == AF_INET){
+      struct ip_mreqn mreqn;
+      memset(&mreqn,0,sizeof(mreqn));
+      mreqn.imr_ifindex = ifindex;
+      if(setsockopt(fd,IPPROTO_IP,IP_MULTICAST_IF,&mreqn,sizeof(mreqn)) != 0)
+        perror("ip_multicast_if");
+    } else {
+      if(setsockopt(fd,IPPROTO_IPV6,IPV6_MULTICAST_IF,&ifindex,sizeof(ifindex)) != 0)
+        perror("ipv6_multicast_if");
+    }
+  }
+
+  struct stream *streams = calloc(nstreams,sizeof(*streams));
+  if(streams == NULL){
+    perror("calloc");
+    exit(EX_OSERR);
+  }
+  for(int i=0; i < nstreams; i++){
+    streams[i].rtp.ssrc = ssrc + i;
+    streams[i].rtp.seq = lrand48();
+    streams[i].rtp.timestamp = lrand48();
+  }
+  if(!quiet)
+    fprintf(stderr,"Sending %d stream(s), SSRC %u-%u, PT %d, %d Hz, %d channel(s), %d bytes/packet to %s\n",
+            nstreams,ssrc,ssrc + nstreams - 1,type,samprate,channels,frames * frame_size,formatsock(&sock));
+
+  signal(SIGINT,closedown);
+  signal(SIGTERM,closedown);
+  srand48(time(NULL));
+
+  double const cycles_per_frame = freq / samprate;
+  double const packet_time = (double)frames / samprate; // seconds of signal per packet
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC,&start);
+  struct timespec next = start;
+  uint64_t npackets = 0;
+  uint8_t buffer[PKTSIZE];
+
+  while(!Stop && (duration <= 0 || npackets * packet_time < duration)){
+    for(int i=0; i < nstreams && !Stop; i++){
+      struct stream *st = &streams[i];
+      int const len = make_packet(st,buffer,type,enc,channels,frames,cycles_per_frame);
+      if(chance(loss)){
+        Lost++;
+        continue;
+      }
+      if(st->held_len == 0 && chance(reorder)){
+        memcpy(st->held,buffer,len);
+        st->held_len = len;
+        Reordered++;
+        continue;
+      }
+      send_packet(fd,buffer,len);
+      if(chance(duplicate)){
+        send_packet(fd,buffer,len);
+        Duplicated++;
+      }
+      if(st->held_len > 0){
+        send_packet(fd,st->held,st->held_len);
+        st->held_len = 0;
+      }
+    }
+    npackets++;
+    if(speed > 0){
+      // Pace against the start time, so the rate doesn't drift
+      double const t = npackets * packet_time / speed;
+      next.tv_sec = start.tv_sec + (time_t)t;
+      next.tv_nsec = start.tv_nsec + (long)((t - floor(t)) * 1e9);
+      if(next.tv_nsec >= 1000000000){
+        next.tv_sec++;
+        next.tv_nsec -= 1000000000;
+      }
+      while(clock_nanosleep(CLOCK_MONOTONIC,TIMER_ABSTIME,&next,NULL) == EINTR && !Stop)
+        ;
+    }
+  }
+  // Don't leave anything behind
+  for(int i=0; i < nstreams; i++){
+    if(streams[i].held_len > 0)
+      send_packet(fd,streams[i].held,streams[i].held_len);
+  }
+
+  if(!quiet){
+    double const t = elapsed(&start);
+    fprintf(stderr,"%llu packets sent in %.3f s: %.0f packets/s, %.0f frames/s per stream (%.2f x real time)\n",
+            (unsigned long long)Sent,t,Sent / t,npackets * frames / t,npackets * packet_time / t);
+    fprintf(stderr,"lost %llu, reordered %llu, duplicated %llu, waited for the socket %llu times, send errors %llu\n",
+            (unsigned long long)Lost,(unsigned long long)Reordered,(unsigned long long)Duplicated,
+            (unsigned long long)Blocked,(unsigned long long)Errors);
+  }
+  close(fd);
+  free(streams);
+  exit(EX_OK);
+}
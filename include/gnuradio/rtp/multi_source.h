@@ -0,0 +1,70 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 Franco Venturi.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_RTP_MULTI_SOURCE_H
+#define INCLUDED_RTP_MULTI_SOURCE_H
+
+#include <gnuradio/block.h>
+#include <gnuradio/rtp/api.h>
+#include <vector>
+
+namespace gr {
+namespace rtp {
+
+/*!
+ * \brief Read many RTP PCM streams (SSRCs) from one multicast group, one output per SSRC
+ * \ingroup rtp
+ *
+ * \details
+ * A single socket receives the whole multicast group and each packet is
+ * routed to its output by SSRC. Each output carries one stream, converted
+ * like the single-output rtp source does (complex for I/Q, mono float or
+ * short, or interleaved shorts), and tagged the same way at discontinuities.
+ * Unless otherwise called, values are within [-1;1].
+ */
+template <class T>
+class RTP_API multi_source : virtual public gr::block
+{
+public:
+    // gr::rtp:multi_source::sptr
+    typedef std::shared_ptr<multi_source<T>> sptr;
+
+    /*!
+     * \brief Make a multi-stream RTP source block
+     *
+     * \param mcast_address multicast address (or mDNS name) of the RTP streams
+     * \param ssrcs SSRC for each output; if empty, outputs are assigned
+     *              to SSRCs in order of appearance
+     * \param num_outputs number of outputs when ssrcs is empty
+     * \param in_channels number of channels in each RTP stream
+     * \param quiet disable info messages
+     * \param batch_size max number of datagrams read per recvmmsg() call
+     */
+    static sptr make(const std::string& mcast_address,
+                     const std::vector<unsigned int>& ssrcs,
+                     int num_outputs=1,
+                     int in_channels=1,
+                     bool quiet=false,
+                     int batch_size=16);
+
+    /*!
+     * \brief Return the number of input channels.
+     */
+    virtual int get_channels() const = 0;
+
+    /*!
+     * Get the SSRC for each output
+     *
+     * \return SSRCs (0 = output not assigned yet)
+     */
+    virtual std::vector<unsigned int> get_ssrcs() const = 0;
+};
+
+} // namespace rtp
+} // namespace gr
+
+#endif /* INCLUDED_RTP_MULTI_SOURCE_H */
@@ -0,0 +1,98 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 Franco Venturi.
+ *
+ * based on:
+ * - the RTP output of radiod in ka9q-radio
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_RTP_SINK_H
+#define INCLUDED_RTP_SINK_H
+
+#include <gnuradio/rtp/api.h>
+#include <gnuradio/sync_block.h>
+
+namespace gr {
+namespace rtp {
+
+/*!
+ * \brief Send a stream as RTP PCM to a multicast group, from gr_complex, floats or shorts
+ * \ingroup rtp
+ *
+ * \details
+ * The stream is sent as 16-bit big-endian PCM (floats are scaled from [-1;1]
+ * and clipped), with the payload type ka9q-radio uses for the sample rate
+ * and the number of channels (pt_from_info()), so the RTP source blocks,
+ * pcmcat and the other ka9q-radio tools can receive it.
+ * Packets are as large as the outgoing interface MTU allows, unless a
+ * smaller size is asked for; they are sent with sendmmsg() in batches.
+ * The block doesn't pace its output: it sends the samples as fast as they
+ * come, which is the stream rate when the flowgraph is driven by a
+ * receiver or a hardware source (use a throttle otherwise).
+ */
+template <class T>
+class RTP_API sink : virtual public gr::sync_block
+{
+public:
+    // gr::rtp:sink::sptr
+    typedef std::shared_ptr<sink<T>> sptr;
+
+    /*!
+     * \brief Make an RTP sink block
+     *
+     * \param mcast_address multicast address (or mDNS name) to send to,
+     *                      as "address[:port][,iface]" (default port 5004)
+     * \param ssrc SSRC of the RTP stream (0 = pick one at random)
+     * \param samp_rate sample rate, for the payload type and the timestamps
+     * \param in_channels number of input ports
+     * \param out_channels number of channels in the RTP stream (1 or 2)
+     * \param samples_per_packet frames per packet (0 = as many as fit in the MTU)
+     * \param ttl multicast TTL (0 = this host only)
+     * \param batch_size max number of datagrams sent per sendmmsg() call
+     */
+    static sptr make(const std::string& mcast_address,
+                     unsigned int ssrc,
+                     int samp_rate,
+                     int in_channels=1,
+                     int out_channels=1,
+                     int samples_per_packet=0,
+                     int ttl=1,
+                     int batch_size=16);
+
+    /*!
+     * \brief Return the SSRC of the stream.
+     */
+    virtual unsigned int get_ssrc() const = 0;
+
+    /*!
+     * \brief Return the RTP payload type of the stream.
+     */
+    virtual int get_payload_type() const = 0;
+
+    /*!
+     * \brief Return the number of frames per packet.
+     */
+    virtual int get_samples_per_packet() const = 0;
+
+    /*!
+     * \brief Return the max number of datagrams sent per call.
+     */
+    virtual int get_batch_size() const = 0;
+
+    /*!
+     * \brief Return the number of packets sent.
+     */
+    virtual uint64_t get_packets() const = 0;
+
+    /*!
+     * \brief Return the number of packets dropped because they couldn't be sent.
+     */
+    virtual uint64_t get_dropped() const = 0;
+};
+
+} // namespace rtp
+} // namespace gr
+
+#endif /* INCLUDED_RTP_SINK_H */
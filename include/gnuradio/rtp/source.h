@@ -14,6 +14,7 @@
 
 #include <gnuradio/rtp/api.h>
 #include <gnuradio/sync_block.h>
+#include <vector>
 
 namespace gr {
 namespace rtp {
@@ -24,6 +25,18 @@ namespace rtp {
  *
  * \details
  * Unless otherwise called, values are within [-1;1].
+ * The output is tagged with rx_time and rx_rate (when the payload type
+ * defines a sample rate) at the start of a session, at every resync
+ * (RTP marker) and at every zero-filled gap, where rtp_gap holds the number
+ * of samples inserted. With rtcp, rx_time is the sender's wall clock time
+ * from its RTCP sender reports, and every new report is tagged.
+ * With status_address, the sample rate and channel count come from the
+ * radiod status of the stream, rx_freq holds its radio frequency, and every
+ * status change is also published on the "status" message port.
+ * The stream counters are published every stats_interval ms on the "stats"
+ * message port, and are available through ControlPort.
+ * A packet (or gap) larger than the output buffer is carried over to the
+ * next calls, so no received sample is dropped for lack of room.
  * Check gr_make_rtp_source() for extra info.
  */
 template <class T>
@@ -33,15 +46,73 @@ public:
     // gr::rtp:source::sptr
     typedef std::shared_ptr<source<T>> sptr;
 
+    /*!
+     * \brief Make an RTP source block
+     *
+     * \param mcast_address multicast address (or mDNS name) of the RTP stream
+     * \param ssrc SSRC of the RTP stream (0 = first SSRC seen)
+     * \param in_channels number of channels in the RTP stream
+     * \param out_channels number of output ports
+     * \param quiet disable info messages
+     * \param batch_size max number of datagrams read per recvmmsg() call
+     * \param ring_depth if > 0, read the socket in a dedicated receiver thread
+     *                   into a ring of this many packets (rounded up to a power of 2);
+     *                   if 0, read the socket directly in work(); with a
+     *                   receiver thread (or shared socket), an idle block
+     *                   sleeps until a packet arrives or the flowgraph stops,
+     *                   while work() wakes up every 100 ms otherwise
+     * \param shared_socket share one socket and receiver thread with all the
+     *                      other source blocks on the same multicast address
+     * \param jitter_packets if > 0, reorder packets by RTP sequence number in a
+     *                       buffer of this many packets; a missing packet is
+     *                       given up (and zero-filled) when the buffer is full
+     * \param jitter_ms if > 0, also give up on a missing packet once it is this
+     *                  many ms late (buffer of 64 packets if jitter_packets is 0)
+     * \param latency_stats record receive path latency histograms, using kernel
+     *                      receive timestamps (SO_TIMESTAMPNS)
+     * \param async_join resolve and join the multicast group in the background
+     *                   (retrying with backoff, and rejoining if the address
+     *                   changes) instead of waiting for it in the constructor
+     * \param zero_copy read the stream from a memory-mapped AF_PACKET
+     *                  (TPACKET_V3) ring instead of the UDP socket, decoding
+     *                  the payloads in place; needs CAP_NET_RAW, ring_depth 0,
+     *                  no shared socket and no async_join (falls back to the
+     *                  UDP socket otherwise)
+     * \param io_uring read the socket with a multishot io_uring recvmsg into
+     *                 preregistered buffers instead of recvmmsg() (Linux 6.0
+     *                 or later); applies to the direct read (ring_depth 0) and
+     *                 the shared socket, not with async_join
+     * \param rtcp listen for RTCP sender reports on the next port, to tag
+     *             rx_time with the sender's wall clock time, and send RTCP
+     *             receiver reports (loss and interarrival jitter) there
+     * \param status_address multicast address (or mDNS name) of the radiod
+     *                       status stream (port 5006 by default), to follow
+     *                       the sample rate, channels and frequency of the
+     *                       stream ("" = off)
+     * \param stats_interval publish the stream counters on the "stats" message
+     *                       port every this many ms (0 = never)
+     */
     static sptr make(const std::string& mcast_address,
                      unsigned int ssrc,
                      int in_channels=1,
                      int out_channels=1,
-                     bool quiet=false);
+                     bool quiet=false,
+                     int batch_size=16,
+                     int ring_depth=0,
+                     bool shared_socket=false,
+                     int jitter_packets=0,
+                     int jitter_ms=0,
+                     bool latency_stats=false,
+                     bool async_join=false,
+                     bool zero_copy=false,
+                     bool io_uring=false,
+                     bool rtcp=false,
+                     const std::string& status_address="",
+                     int stats_interval=1000);
 
     /*!
-     * \brief Return the number of bits per sample.
-     * the RTP stream.
+     * \brief Return the number of bits per sample in the RTP payload
+     * (from the RTP payload type; 16 until the first packet).
      */
     virtual int get_bits_per_sample() const = 0;
 
@@ -63,6 +134,129 @@ public:
      * \return current SSRC
      */
     virtual unsigned int get_ssrc() const = 0;
+
+    /*!
+     * \brief Return the max number of datagrams read per call.
+     */
+    virtual int get_batch_size() const = 0;
+
+    /*!
+     * \brief Return the receiver ring depth in packets (0 = no receiver thread).
+     */
+    virtual int get_ring_depth() const = 0;
+
+    /*!
+     * \brief Return the number of packets dropped because the receiver ring was full
+     * (or the AF_PACKET ring, with zero_copy).
+     */
+    virtual uint64_t get_ring_overruns() const = 0;
+
+    /*!
+     * \brief Return the highest number of packets queued in the receiver ring.
+     */
+    virtual int get_ring_high_water() const = 0;
+
+    /*!
+     * \brief Return the number of datagrams dropped because they were bigger
+     * than the receive buffers (sized from the interface MTU).
+     */
+    virtual uint64_t get_truncated() const = 0;
+
+    /*!
+     * \brief Return the jitter buffer depth in packets (0 = no reordering).
+     */
+    virtual int get_jitter_depth() const = 0;
+
+    /*!
+     * \brief Return the number of packets received on the stream.
+     */
+    virtual uint64_t get_packets() const = 0;
+
+    /*!
+     * \brief Return the number of RTP payload bytes received on the stream.
+     */
+    virtual uint64_t get_bytes() const = 0;
+
+    /*!
+     * \brief Return the number of packets missing from the sequence when played
+     * (never received, given up on, or out of order without a jitter buffer).
+     */
+    virtual uint64_t get_drops() const = 0;
+
+    /*!
+     * \brief Return the number of duplicate packets, and of packets too old to play.
+     */
+    virtual uint64_t get_dupes() const = 0;
+
+    /*!
+     * \brief Return the number of zero samples (per channel) output in place of
+     * missing ones.
+     */
+    virtual uint64_t get_zero_filled() const = 0;
+
+    /*!
+     * \brief Return the reorder depth: the most packets a packet arrived behind
+     * a later one.
+     */
+    virtual int get_reorder_depth() const = 0;
+
+    /*!
+     * \brief Return the number of packets received out of order and put back in sequence.
+     */
+    virtual uint64_t get_reordered() const = 0;
+
+    /*!
+     * \brief Return the number of packets dropped because they arrived after their turn.
+     */
+    virtual uint64_t get_late() const = 0;
+
+    /*!
+     * \brief Return the number of packets never received (zero-filled).
+     */
+    virtual uint64_t get_lost() const = 0;
+
+    /*!
+     * \brief Return the kernel receive -> socket read latency p50, p99 and p99.9 in us.
+     *
+     * Network stack and receiver thread scheduling delay; all zeros unless
+     * latency_stats is enabled.
+     */
+    virtual std::vector<float> get_kernel_latency() const = 0;
+
+    /*!
+     * \brief Return the socket read -> output buffer latency p50, p99 and p99.9 in us.
+     *
+     * Time spent queued in the ring and waiting for the scheduler; all zeros
+     * unless latency_stats is enabled.
+     */
+    virtual std::vector<float> get_output_latency() const = 0;
+
+    /*!
+     * \brief Clear the latency histograms.
+     */
+    virtual void reset_latency() = 0;
+
+    /*!
+     * \brief Return the RTP interarrival jitter (RFC 3550) in ms.
+     *
+     * As sent in the RTCP receiver reports (with rtcp). Arrival times are kernel receive timestamps with latency_stats,
+     * the time the packets are read otherwise.
+     */
+    virtual float get_interarrival_jitter() const = 0;
+
+    /*!
+     * \brief Return the sample rate of the stream in Hz (0 = unknown).
+     *
+     * From the radiod status when there is one, else from the RTP payload type.
+     */
+    virtual int get_samp_rate() const = 0;
+
+    /*!
+     * \brief Return the radio frequency of the stream in Hz (0 = unknown).
+     *
+     * From the radiod status; 0 unless status_address is set.
+     */
+    virtual double get_frequency() const = 0;
 };
 
 } // namespace rtp
@@ -0,0 +1,227 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 Franco Venturi.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+// Microbenchmarks for the RTP source receive path (Google Benchmark)
+// Run bench_rtp_source from the build directory; iterations are datagrams,
+// and the session benchmarks also report the output samples per second.
+// Use --benchmark_filter to pick a part, e.g. --benchmark_filter=process<float>
+
+#include <gnuradio/logger.h>
+#include <gnuradio/types.h>
+#include <benchmark/benchmark.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "convert.h"
+#include "multicast.h"
+#include "rtp_info.h"
+#include "session.h"
+
+using namespace gr::rtp;
+
+// Synthetic datagrams with the header radiod sends, one SSRC per stream
+static std::vector<std::vector<uint8_t>>
+make_packets(int count, int payload_size, int nssrcs, int csrcs = 0, int type = PCM_MONO_PT)
+{
+    std::vector<std::vector<uint8_t>> packets(count);
+    for (int i = 0; i < count; i++) {
+        struct rtp_header rtp;
+        memset(&rtp, 0, sizeof(rtp));
+        rtp.version = 2;
+        rtp.type = type;
+        rtp.seq = i;
+        rtp.timestamp = i * payload_size / 2;
+        rtp.ssrc = 1000 + i % nssrcs;
+        rtp.cc = csrcs;
+        auto& packet = packets[i];
+        packet.resize(RTP_MIN_SIZE + 4 * csrcs + payload_size);
+        auto dp = static_cast<uint8_t *>(hton_rtp(packet.data(), &rtp));
+        memset(dp, i & 0xff, payload_size);
+    }
+    return packets;
+}
+
+// Header parsing with no SSRC filter (shared socket demux, multi source)
+static void BM_parse_rtp(benchmark::State& state)
+{
+    auto const packets = make_packets(256, 960, 1, state.range(0));
+    size_t i = 0;
+    for (auto _ : state) {
+        auto const& p = packets[i++ & 0xff];
+        rtp_info rtp;
+        uint8_t const *dp;
+        benchmark::DoNotOptimize(parse_rtp(p.data(), p.size(), 0, rtp, &dp));
+        benchmark::DoNotOptimize(rtp);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_parse_rtp)->ArgName("csrcs")->Arg(0)->Arg(2);
+
+// The general parser alone, for comparison
+static void BM_ntoh_rtp(benchmark::State& state)
+{
+    auto const packets = make_packets(256, 960, 1, state.range(0));
+    size_t i = 0;
+    for (auto _ : state) {
+        auto const& p = packets[i++ & 0xff];
+        struct rtp_header rtp;
+        benchmark::DoNotOptimize(ntoh_rtp(&rtp, p.data()));
+        benchmark::DoNotOptimize(rtp);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ntoh_rtp)->ArgName("csrcs")->Arg(0)->Arg(2);
+
+// One block's view of a group carrying many SSRCs: almost every datagram is
+// somebody else's and has to be rejected
+static void BM_parse_rtp_filter(benchmark::State& state)
+{
+    int const nssrcs = state.range(0);
+    auto const packets = make_packets(256, 960, nssrcs);
+    size_t i = 0;
+    int64_t accepted = 0;
+    for (auto _ : state) {
+        auto const& p = packets[i++ & 0xff];
+        rtp_info rtp;
+        uint8_t const *dp;
+        if (parse_rtp(p.data(), p.size(), 1000, rtp, &dp) > 0) {
+            accepted++;
+        }
+    }
+    benchmark::DoNotOptimize(accepted);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_parse_rtp_filter)->ArgName("ssrcs")->Arg(1)->Arg(16)->Arg(256);
+
+// Everything work() does with a datagram once it has it: parse the header,
+// check the SSRC, then decode the payload into the output buffers with
+// session::process(), for one payload type and output layout.
+// Arguments: RTP payload type, session channels, output ports,
+// payload bytes, and a packet lost every that many (0 = none) to exercise
+// the zero-fill of the gaps
+template <class T>
+static void BM_process(benchmark::State& state)
+{
+    int const type = state.range(0);
+    int const channels = state.range(1);
+    int const noutputs = state.range(2);
+    int const payload_size = state.range(3);
+    int const loss_interval = state.range(4);
+
+    auto logger = std::make_shared<gr::logger>("bench_rtp_source");
+    logger->set_level(gr::log_level::err); // not the gap messages
+    gr::rtp::session<T> session(channels, true, logger);
+
+    auto packets = make_packets(1, payload_size, 1, 0, type);
+    auto& packet = packets[0];
+    payload_format const format = payload_format_from_pt(type);
+    int const frames = payload_samples(format.enc, payload_size) /
+                       (format.channels != 0 ? format.channels : channels);
+
+    struct sockaddr_in sender;
+    memset(&sender, 0, sizeof(sender));
+    sender.sin_family = AF_INET;
+    sender.sin_port = htons(5004);
+    sender.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    // Room for a few packets plus a gap: the output is consumed every time it's full
+    int const noutput_items = 16 * 2 * std::max(frames, 1) * 2;
+    std::vector<std::vector<T>> buffers(noutputs, std::vector<T>(noutput_items));
+    std::vector<T *> outs(noutputs);
+    for (int i = 0; i < noutputs; i++) {
+        outs[i] = buffers[i].data();
+    }
+
+    uint16_t seq = 0;
+    uint32_t timestamp = 0;
+    int produced = 0;
+    int64_t samples = 0;
+    for (auto _ : state) {
+        // Next packet in sequence: just update the sequence number and the timestamp
+        if (loss_interval > 0 && seq % loss_interval == loss_interval - 1) {
+            seq++;
+            timestamp += frames;
+        }
+        uint16_t const seq_n = htons(seq);
+        uint32_t const timestamp_n = htonl(timestamp);
+        memcpy(&packet[2], &seq_n, sizeof(seq_n));
+        memcpy(&packet[4], &timestamp_n, sizeof(timestamp_n));
+        seq++;
+        timestamp += frames;
+
+        rtp_info rtp;
+        uint8_t const *dp = nullptr;
+        int const size = parse_rtp(packet.data(), packet.size(), 1000, rtp, &dp);
+        if (size <= 0) {
+            state.SkipWithError("bad RTP packet");
+            break;
+        }
+        int const start = produced;
+        if (!session.process(&rtp, dp, size, reinterpret_cast<struct sockaddr *>(&sender),
+                             outs.data(), noutput_items, noutputs, produced)) {
+            // Output full: hand it over and start again
+            produced = 0;
+            session.process(&rtp, dp, size, reinterpret_cast<struct sockaddr *>(&sender),
+                            outs.data(), noutput_items, noutputs, produced);
+            samples += produced;
+        } else {
+            samples += produced - start;
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * payload_size);
+    state.counters["samples"] = benchmark::Counter(samples, benchmark::Counter::kIsRate);
+}
+
+// Payload sizes: 5 ms of 12 kHz mono, radiod's usual 960 bytes, and a full 1500 MTU
+static void process_sizes(benchmark::internal::Benchmark *b, int type, int channels, int noutputs)
+{
+    for (int size : { 240, 960, 1440 }) {
+        b->Args({ type, channels, noutputs, size, 0 });
+    }
+}
+
+#define PROCESS_ARG_NAMES { "pt", "ch", "outs", "bytes", "loss" }
+
+// gr_complex: I/Q pairs, and real samples with a zero imaginary part
+BENCHMARK_TEMPLATE(BM_process, gr_complex)
+    ->ArgNames(PROCESS_ARG_NAMES)
+    ->Apply([](benchmark::internal::Benchmark *b) {
+        process_sizes(b, PCM_STEREO_PT, 2, 1);
+        process_sizes(b, PCM_MONO_PT, 1, 1);
+        process_sizes(b, AIRSPY_PACKED, 1, 1);
+    });
+
+// float: mono, stereo (deinterleaved), downmixed stereo and pseudo-stereo
+BENCHMARK_TEMPLATE(BM_process, float)
+    ->ArgNames(PROCESS_ARG_NAMES)
+    ->Apply([](benchmark::internal::Benchmark *b) {
+        process_sizes(b, PCM_MONO_PT, 1, 1);
+        process_sizes(b, PCM_STEREO_PT, 2, 2);
+        process_sizes(b, PCM_STEREO_PT, 2, 1);
+        process_sizes(b, PCM_MONO_PT, 1, 2);
+        process_sizes(b, AIRSPY_PACKED, 1, 1);
+        // gap handling: zero-fill one packet in 8
+        b->Args({ PCM_MONO_PT, 1, 1, 960, 8 });
+    });
+
+// short: mono, stereo (deinterleaved) and interleaved I/Q on one output
+BENCHMARK_TEMPLATE(BM_process, std::int16_t)
+    ->ArgNames(PROCESS_ARG_NAMES)
+    ->Apply([](benchmark::internal::Benchmark *b) {
+        process_sizes(b, PCM_MONO_PT, 1, 1);
+        process_sizes(b, PCM_STEREO_PT, 2, 2);
+        process_sizes(b, PCM_STEREO_PT, 2, 1);
+    });
+
+BENCHMARK_MAIN();
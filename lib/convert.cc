@@ -0,0 +1,1116 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 Franco Venturi.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "convert.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "multicast.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#if defined(__SSE2__)
+#define RTP_CONVERT_SSE2 1
+#include <immintrin.h>
+#if defined(__GNUC__)
+// compiled with target attributes, used if the CPU has them (checked at run time)
+#define RTP_CONVERT_SSSE3 1
+#define RTP_CONVERT_AVX2 1
+#endif
+#endif
+#elif defined(__aarch64__)
+#define RTP_CONVERT_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace gr {
+namespace rtp {
+
+static float const Scale = 32767.0f;
+
+static float const Scale8 = 127.0f;
+static float const Scale12 = 2048.0f;
+
+static inline int16_t get_s16be(uint8_t const *p)
+{
+    return static_cast<int16_t>(p[0] << 8 | p[1]);
+}
+
+static inline int16_t get_s16le(uint8_t const *p)
+{
+    return static_cast<int16_t>(p[1] << 8 | p[0]);
+}
+
+// Sample i of a 12-bit packed big-endian payload: 2 samples in 3 bytes
+static inline int16_t get_s12be(uint8_t const *p, int i)
+{
+    p += 3 * (i / 2);
+    int const v = (i % 2 == 0) ? (p[0] << 4 | p[1] >> 4) : ((p[1] & 0x0f) << 8 | p[2]);
+    return static_cast<int16_t>(static_cast<int16_t>(v << 4) >> 4); // sign extend
+}
+
+// Sample i of an Airspy packed payload: each 32-bit little-endian word,
+// read most significant bit first, continues a stream of 12-bit samples
+static inline int16_t get_airspy12(uint8_t const *p, int i)
+{
+    p += 12 * (i / 8);
+    int const k = 3 * ((i % 8) / 2); // first byte of the sample pair in the stream
+    auto b = [p](int k) { return p[(k & ~3) + 3 - (k & 3)]; };
+    int const v = (i % 2 == 0) ? (b(k) << 4 | b(k + 1) >> 4) : ((b(k + 1) & 0x0f) << 8 | b(k + 2));
+    return static_cast<int16_t>(v - 2048);
+}
+
+static inline float get_f32le(uint8_t const *p)
+{
+    uint32_t const u = uint32_t(p[0]) | uint32_t(p[1]) << 8 |
+                       uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+payload_format payload_format_from_pt(int pt)
+{
+    switch (pt) {
+    case PCM_MONO_PT:
+    case PCM_MONO_24_PT:
+    case PCM_MONO_16_PT:
+    case PCM_MONO_12_PT:
+    case PCM_MONO_8_PT:
+        return { encoding::S16BE, 1, 16 };
+    case PCM_STEREO_PT:
+    case PCM_STEREO_24_PT:
+    case PCM_STEREO_16_PT:
+    case PCM_STEREO_12_PT:
+    case PCM_STEREO_8_PT:
+        return { encoding::S16BE, 2, 16 };
+    case PCM_MONO_LE_PT:
+    case REAL_PT: // little endian, like IQ_PT
+        return { encoding::S16LE, 1, 16 };
+    case PCM_STEREO_LE_PT:
+    case IQ_PT:
+        return { encoding::S16LE, 2, 16 };
+    case REAL_PT8:
+        return { encoding::S8, 1, 8 };
+    case IQ_PT8:
+        return { encoding::S8, 2, 8 };
+    case REAL_PT12:
+        return { encoding::S12BE, 1, 12 };
+    case IQ_PT12:
+        return { encoding::S12BE, 2, 12 };
+    case IQ_FLOAT:
+        return { encoding::F32LE, 2, 32 };
+    case AIRSPY_PACKED:
+        return { encoding::AIRSPY12, 1, 12 };
+    case AX25_PT:
+    case OPUS_PT:
+        return { encoding::NONE, 0, 0 };
+    default:
+        // anything else: assume standard PCM, channels as configured
+        return { encoding::S16BE, 0, 16 };
+    }
+}
+
+int payload_samples(encoding enc, int size)
+{
+    switch (enc) {
+    case encoding::S16BE:
+    case encoding::S16LE:
+        return size / 2;
+    case encoding::S8:
+        return size;
+    case encoding::S12BE:
+        return size / 3 * 2;
+    case encoding::AIRSPY12:
+        return size / 12 * 8;
+    case encoding::F32LE:
+        return size / 4;
+    default:
+        return 0;
+    }
+}
+
+// Scalar versions; they also finish the tails of the vector versions
+
+namespace convert_generic {
+
+void s16be_f32(void const *in, float *out, int n)
+{
+    auto p = static_cast<uint8_t const *>(in);
+    for (int i = 0; i < n; i++, p += 2) {
+        out[i] = static_cast<float>(get_s16be(p)) / Scale;
+    }
+}
+
+void s16be_cf32_real(void const *in, float *out, int n)
+{
+    auto p = static_cast<uint8_t const *>(in);
+    for (int i = 0; i < n; i++, p += 2) {
+        out[2 * i] = static_cast<float>(get_s16be(p)) / Scale;
+        out[2 * i + 1] = 0.0f;
+    }
+}
+
+void s16be_f32_deinterleave(void const *in, float *left, float *right, int n)
+{
+    auto p = static_cast<uint8_t const *>(in);
+    for (int i = 0; i < n; i++, p += 4) {
+        left[i] = static_cast<float>(get_s16be(p)) / Scale;
+        right[i] = static_cast<float>(get_s16be(p + 2)) / Scale;
+    }
+}
+
+void s16be_f32_downmix(void const *in, float *out, int n)
+{
+    auto p = static_cast<uint8_t const *>(in);
+    for (int i = 0; i < n; i++, p += 4) {
+        float const leftf = static_cast<float>(get_s16be(p)) / Scale;
+        float const rightf = static_cast<float>(get_s16be(p + 2)) / Scale;
+        out[i] = (leftf + rightf) * 0.5f; // same as / 2.0: halving is exact
+    }
+}
+
+void s16be_f32_dup(void const *in, float *left, float *right, int n)
+{
+    auto p = static_cast<uint8_t const *>(in);
+    for (int i = 0; i < n; i++, p += 2) {
+        float const df = static_cast<float>(get_s16be(p)) / Scale;
+        left[i] = df;
+        right[i] = df;
+    }
+}
+
+void s16be_s16(void const *in, int16_t *out, int n)
+{
+    auto p = static_cast<uint8_t const *>(in);
+    for (int i = 0; i < n; i++, p += 2) {
+        out[i] = get_s16be(p);
+    }
+}
+
+void s16be_s16_deinterleave(void const *in, int16_t *left, int16_t *right, int n)
+{
+    auto p = static_cast<uint8_t const *>(in);
+    for (int i = 0; i < n; i++, p += 4) {
+        left[i] = get_s16be(p);
+        right[i] = get_s16be(p + 2);
+    }
+}
+
+void s16be_s16_dup(void const *in, int16_t *left, int16_t *right, int n)
+{
+    auto p = static_cast<uint8_t const *>(in);
+    for (int i = 0; i < n; i++, p += 2) {
+        int16_t const d = get_s16be(p);
+        left[i] = d;
+        right[i] = d;
+    }
+}
+
+void decode_f32(encoding enc, void const *in, float *out, int n)
+{
+    auto p = static_cast<uint8_t const *>(in);
+    switch (enc) {
+    case encoding::S16BE:
+        s16be_f32(in, out, n);
+        break;
+    case encoding::S16LE:
+        for (int i = 0; i < n; i++, p += 2) {
+            out[i] = static_cast<float>(get_s16le(p)) / Scale;
+        }
+        break;
+    case encoding::S8:
+        for (int i = 0; i < n; i++) {
+            out[i] = static_cast<float>(static_cast<int8_t>(p[i])) / Scale8;
+        }
+        break;
+    case encoding::S12BE:
+        for (int i = 0; i < n; i++) {
+            out[i] = static_cast<float>(get_s12be(p, i)) / Scale12;
+        }
+        break;
+    case encoding::F32LE:
+        for (int i = 0; i < n; i++, p += 4) {
+            out[i] = get_f32le(p);
+        }
+        break;
+    case encoding::AIRSPY12:
+        for (int i = 0; i < n; i++) {
+            out[i] = static_cast<float>(get_airspy12(p, i)) / Scale12;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void decode_s16(encoding enc, void const *in, int16_t *out, int n)
+{
+    auto p = static_cast<uint8_t const *>(in);
+    switch (enc) {
+    case encoding::S16BE:
+        s16be_s16(in, out, n);
+        break;
+    case encoding::S16LE:
+        for (int i = 0; i < n; i++, p += 2) {
+            out[i] = get_s16le(p);
+        }
+        break;
+    case encoding::S8:
+        for (int i = 0; i < n; i++) {
+            out[i] = static_cast<int16_t>(static_cast<int8_t>(p[i]) * 256);
+        }
+        break;
+    case encoding::S12BE:
+        for (int i = 0; i < n; i++) {
+            out[i] = static_cast<int16_t>(get_s12be(p, i) * 16);
+        }
+        break;
+    case encoding::F32LE:
+        for (int i = 0; i < n; i++, p += 4) {
+            float const f = std::min(std::max(get_f32le(p), -1.0f), 1.0f);
+            out[i] = static_cast<int16_t>(std::lrint(f * Scale));
+        }
+        break;
+    case encoding::AIRSPY12:
+        for (int i = 0; i < n; i++) {
+            out[i] = static_cast<int16_t>(get_airspy12(p, i) * 16);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+} // namespace convert_generic
+
+
+#if defined(RTP_CONVERT_SSE2)
+
+// Load 8 big-endian shorts and swap them to host order
+static inline __m128i load_s16be_sse2(uint8_t const *p)
+{
+    __m128i const v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(p));
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+// Scale 8 host order shorts to two vectors of 4 floats
+static inline void s16_to_f32_sse2(__m128i v, __m128& lo, __m128& hi)
+{
+    __m128 const scale = _mm_set1_ps(Scale);
+    lo = _mm_div_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16)), scale);
+    hi = _mm_div_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16)), scale);
+}
+
+static int s16be_f32_sse2(uint8_t const *p, float *out, int n)
+{
+    int i = 0;
+    for (; i + 8 <= n; i += 8, p += 16) {
+        __m128 lo, hi;
+        s16_to_f32_sse2(load_s16be_sse2(p), lo, hi);
+        _mm_storeu_ps(out + i, lo);
+        _mm_storeu_ps(out + i + 4, hi);
+    }
+    return i;
+}
+
+static int s16be_cf32_real_sse2(uint8_t const *p, float *out, int n)
+{
+    __m128 const zero = _mm_setzero_ps();
+    int i = 0;
+    for (; i + 8 <= n; i += 8, p += 16) {
+        __m128 lo, hi;
+        s16_to_f32_sse2(load_s16be_sse2(p), lo, hi);
+        _mm_storeu_ps(out + 2 * i, _mm_unpacklo_ps(lo, zero));
+        _mm_storeu_ps(out + 2 * i + 4, _mm_unpackhi_ps(lo, zero));
+        _mm_storeu_ps(out + 2 * i + 8, _mm_unpacklo_ps(hi, zero));
+        _mm_storeu_ps(out + 2 * i + 12, _mm_unpackhi_ps(hi, zero));
+    }
+    return i;
+}
+
+// 4 stereo frames -> 4 left and 4 right floats
+static inline void deinterleave_f32_sse2(uint8_t const *p, __m128& left, __m128& right)
+{
+    __m128 lo, hi;
+    s16_to_f32_sse2(load_s16be_sse2(p), lo, hi);
+    left = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+    right = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+}
+
+static int s16be_f32_deinterleave_sse2(uint8_t const *p, float *left, float *right, int n)
+{
+    int i = 0;
+    for (; i + 4 <= n; i += 4, p += 16) {
+        __m128 l, r;
+        deinterleave_f32_sse2(p, l, r);
+        _mm_storeu_ps(left + i, l);
+        _mm_storeu_ps(right + i, r);
+    }
+    return i;
+}
+
+static int s16be_f32_downmix_sse2(uint8_t const *p, float *out, int n)
+{
+    __m128 const half = _mm_set1_ps(0.5f);
+    int i = 0;
+    for (; i + 4 <= n; i += 4, p += 16) {
+        __m128 l, r;
+        deinterleave_f32_sse2(p, l, r);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_add_ps(l, r), half));
+    }
+    return i;
+}
+
+static int s16be_f32_dup_sse2(uint8_t const *p, float *left, float *right, int n)
+{
+    int i = 0;
+    for (; i + 8 <= n; i += 8, p += 16) {
+        __m128 lo, hi;
+        s16_to_f32_sse2(load_s16be_sse2(p), lo, hi);
+        _mm_storeu_ps(left + i, lo);
+        _mm_storeu_ps(left + i + 4, hi);
+        _mm_storeu_ps(right + i, lo);
+        _mm_storeu_ps(right + i + 4, hi);
+    }
+    return i;
+}
+
+static int s16be_s16_sse2(uint8_t const *p, int16_t *out, int n)
+{
+    int i = 0;
+    for (; i + 8 <= n; i += 8, p += 16) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), load_s16be_sse2(p));
+    }
+    return i;
+}
+
+static int s16be_s16_deinterleave_sse2(uint8_t const *p, int16_t *left, int16_t *right, int n)
+{
+    int i = 0;
+    for (; i + 8 <= n; i += 8, p += 32) {
+        __m128i const a = load_s16be_sse2(p);
+        __m128i const b = load_s16be_sse2(p + 16);
+        // left is the low half of each 32-bit frame, right the high half
+        __m128i const l = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a, 16), 16),
+                                          _mm_srai_epi32(_mm_slli_epi32(b, 16), 16));
+        __m128i const r = _mm_packs_epi32(_mm_srai_epi32(a, 16), _mm_srai_epi32(b, 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(left + i), l);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(right + i), r);
+    }
+    return i;
+}
+
+static int s16be_s16_dup_sse2(uint8_t const *p, int16_t *left, int16_t *right, int n)
+{
+    int i = 0;
+    for (; i + 8 <= n; i += 8, p += 16) {
+        __m128i const v = load_s16be_sse2(p);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(left + i), v);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(right + i), v);
+    }
+    return i;
+}
+
+// 8 little-endian shorts -> floats
+static int s16le_f32_sse2(uint8_t const *p, float *out, int n)
+{
+    int i = 0;
+    for (; i + 8 <= n; i += 8, p += 16) {
+        __m128 lo, hi;
+        s16_to_f32_sse2(_mm_loadu_si128(reinterpret_cast<__m128i const *>(p)), lo, hi);
+        _mm_storeu_ps(out + i, lo);
+        _mm_storeu_ps(out + i + 4, hi);
+    }
+    return i;
+}
+
+static int s8_f32_sse2(uint8_t const *p, float *out, int n)
+{
+    __m128 const scale = _mm_set1_ps(Scale8);
+    int i = 0;
+    for (; i + 16 <= n; i += 16, p += 16) {
+        __m128i const v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(p));
+        // sign extend by moving each byte to the top of a short, then of an int
+        __m128i const lo = _mm_unpacklo_epi8(v, v);
+        __m128i const hi = _mm_unpackhi_epi8(v, v);
+        __m128i const w[4] = { _mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 24),
+                               _mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 24),
+                               _mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 24),
+                               _mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 24) };
+        for (int k = 0; k < 4; k++) {
+            _mm_storeu_ps(out + i + 4 * k, _mm_div_ps(_mm_cvtepi32_ps(w[k]), scale));
+        }
+    }
+    return i;
+}
+
+static int s8_s16_sse2(uint8_t const *p, int16_t *out, int n)
+{
+    __m128i const zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 16 <= n; i += 16, p += 16) {
+        __m128i const v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(p));
+        // byte in the top half of each short == sample * 256
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_unpacklo_epi8(zero, v));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i + 8), _mm_unpackhi_epi8(zero, v));
+    }
+    return i;
+}
+
+#endif /* RTP_CONVERT_SSE2 */
+
+
+#if defined(RTP_CONVERT_SSSE3)
+
+static bool have_ssse3()
+{
+    static bool const ssse3 = __builtin_cpu_supports("ssse3");
+    return ssse3;
+}
+
+// Sign extend 8 gathered 12-bit samples:
+// even samples are the top 12 bits of their short, odd samples the bottom 12 bits
+__attribute__((target("ssse3"))) static inline __m128i s12_extend_ssse3(__m128i v)
+{
+    __m128i const even = _mm_setr_epi16(-1, 0, -1, 0, -1, 0, -1, 0);
+    __m128i const hi = _mm_srai_epi16(v, 4);
+    __m128i const lo = _mm_srai_epi16(_mm_slli_epi16(v, 4), 4);
+    return _mm_or_si128(_mm_and_si128(even, hi), _mm_andnot_si128(even, lo));
+}
+
+// 12 bytes of 12-bit packed big-endian samples -> 8 host order shorts
+// Each short gets the two bytes holding its sample, most significant first
+__attribute__((target("ssse3"))) static inline __m128i load_s12be_ssse3(uint8_t const *p)
+{
+    __m128i const gather = _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    return s12_extend_ssse3(
+        _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const *>(p)), gather));
+}
+
+// 3 Airspy packed words -> 8 host order shorts
+// Same as above with the bytes of each word reversed; flipping the top bit
+// of each sample turns offset-2048 into two's complement
+__attribute__((target("ssse3"))) static inline __m128i load_airspy12_ssse3(uint8_t const *p)
+{
+    __m128i const gather = _mm_setr_epi8(2, 3, 1, 2, 7, 0, 6, 7, 4, 5, 11, 4, 9, 10, 8, 9);
+    __m128i const offset = _mm_setr_epi16(-0x8000, 0x0800, -0x8000, 0x0800,
+                                          -0x8000, 0x0800, -0x8000, 0x0800);
+    __m128i const v = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const *>(p)), gather);
+    return s12_extend_ssse3(_mm_xor_si128(v, offset));
+}
+
+// The 16-byte loads read 4 bytes past the 12 used, hence i + 11 <= n
+__attribute__((target("ssse3"))) static int s12be_f32_ssse3(uint8_t const *p, float *out, int n)
+{
+    __m128 const scale = _mm_set1_ps(Scale12);
+    int i = 0;
+    for (; i + 11 <= n; i += 8, p += 12) {
+        __m128i const v = load_s12be_ssse3(p);
+        __m128 const lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+        __m128 const hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16));
+        _mm_storeu_ps(out + i, _mm_div_ps(lo, scale));
+        _mm_storeu_ps(out + i + 4, _mm_div_ps(hi, scale));
+    }
+    return i;
+}
+
+__attribute__((target("ssse3"))) static int s12be_s16_ssse3(uint8_t const *p, int16_t *out, int n)
+{
+    int i = 0;
+    for (; i + 11 <= n; i += 8, p += 12) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_slli_epi16(load_s12be_ssse3(p), 4));
+    }
+    return i;
+}
+
+__attribute__((target("ssse3"))) static int airspy12_f32_ssse3(uint8_t const *p, float *out, int n)
+{
+    __m128 const scale = _mm_set1_ps(Scale12);
+    int i = 0;
+    for (; i + 11 <= n; i += 8, p += 12) {
+        __m128i const v = load_airspy12_ssse3(p);
+        __m128 const lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+        __m128 const hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16));
+        _mm_storeu_ps(out + i, _mm_div_ps(lo, scale));
+        _mm_storeu_ps(out + i + 4, _mm_div_ps(hi, scale));
+    }
+    return i;
+}
+
+__attribute__((target("ssse3"))) static int airspy12_s16_ssse3(uint8_t const *p, int16_t *out, int n)
+{
+    int i = 0;
+    for (; i + 11 <= n; i += 8, p += 12) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_slli_epi16(load_airspy12_ssse3(p), 4));
+    }
+    return i;
+}
+
+#endif /* RTP_CONVERT_SSSE3 */
+
+
+#if defined(RTP_CONVERT_AVX2)
+
+static bool have_avx2()
+{
+    static bool const avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+}
+
+__attribute__((target("avx2"))) static int s16be_f32_avx2(uint8_t const *p, float *out, int n)
+{
+    __m256i const swap = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+                                          1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    __m256 const scale = _mm256_set1_ps(Scale);
+    int i = 0;
+    for (; i + 16 <= n; i += 16, p += 32) {
+        __m256i const v = _mm256_shuffle_epi8(
+            _mm256_loadu_si256(reinterpret_cast<__m256i const *>(p)), swap);
+        __m256 const lo = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_castsi256_si128(v)));
+        __m256 const hi = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_extracti128_si256(v, 1)));
+        _mm256_storeu_ps(out + i, _mm256_div_ps(lo, scale));
+        _mm256_storeu_ps(out + i + 8, _mm256_div_ps(hi, scale));
+    }
+    return i;
+}
+
+__attribute__((target("avx2"))) static int s16be_s16_avx2(uint8_t const *p, int16_t *out, int n)
+{
+    __m256i const swap = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+                                          1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    int i = 0;
+    for (; i + 16 <= n; i += 16, p += 32) {
+        __m256i const v = _mm256_shuffle_epi8(
+            _mm256_loadu_si256(reinterpret_cast<__m256i const *>(p)), swap);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), v);
+    }
+    return i;
+}
+
+#endif /* RTP_CONVERT_AVX2 */
+
+
+#if defined(RTP_CONVERT_NEON)
+
+// Load 8 big-endian shorts and swap them to host order
+static inline int16x8_t load_s16be_neon(uint8_t const *p)
+{
+    return vreinterpretq_s16_u8(vrev16q_u8(vld1q_u8(p)));
+}
+
+static inline float32x4_t s16_to_f32_neon(int16x4_t v)
+{
+    return vdivq_f32(vcvtq_f32_s32(vmovl_s16(v)), vdupq_n_f32(Scale));
+}
+
+static int s16be_f32_neon(uint8_t const *p, float *out, int n)
+{
+    int i = 0;
+    for (; i + 8 <= n; i += 8, p += 16) {
+        int16x8_t const v = load_s16be_neon(p);
+        vst1q_f32(out + i, s16_to_f32_neon(vget_low_s16(v)));
+        vst1q_f32(out + i + 4, s16_to_f32_neon(vget_high_s16(v)));
+    }
+    return i;
+}
+
+static int s16be_cf32_real_neon(uint8_t const *p, float *out, int n)
+{
+    float32x4x2_t c;
+    c.val[1] = vdupq_n_f32(0.0f);
+    int i = 0;
+    for (; i + 8 <= n; i += 8, p += 16) {
+        int16x8_t const v = load_s16be_neon(p);
+        c.val[0] = s16_to_f32_neon(vget_low_s16(v));
+        vst2q_f32(out + 2 * i, c);
+        c.val[0] = s16_to_f32_neon(vget_high_s16(v));
+        vst2q_f32(out + 2 * i + 8, c);
+    }
+    return i;
+}
+
+static int s16be_f32_deinterleave_neon(uint8_t const *p, float *left, float *right, int n)
+{
+    int i = 0;
+    for (; i + 4 <= n; i += 4, p += 16) {
+        int16x4x2_t const v = vld2_s16(reinterpret_cast<int16_t const *>(p));
+        int16x4_t const l = vreinterpret_s16_u8(vrev16_u8(vreinterpret_u8_s16(v.val[0])));
+        int16x4_t const r = vreinterpret_s16_u8(vrev16_u8(vreinterpret_u8_s16(v.val[1])));
+        vst1q_f32(left + i, s16_to_f32_neon(l));
+        vst1q_f32(right + i, s16_to_f32_neon(r));
+    }
+    return i;
+}
+
+static int s16be_f32_downmix_neon(uint8_t const *p, float *out, int n)
+{
+    int i = 0;
+    for (; i + 4 <= n; i += 4, p += 16) {
+        int16x4x2_t const v = vld2_s16(reinterpret_cast<int16_t const *>(p));
+        int16x4_t const l = vreinterpret_s16_u8(vrev16_u8(vreinterpret_u8_s16(v.val[0])));
+        int16x4_t const r = vreinterpret_s16_u8(vrev16_u8(vreinterpret_u8_s16(v.val[1])));
+        float32x4_t const sum = vaddq_f32(s16_to_f32_neon(l), s16_to_f32_neon(r));
+        vst1q_f32(out + i, vmulq_n_f32(sum, 0.5f));
+    }
+    return i;
+}
+
+static int s16be_f32_dup_neon(uint8_t const *p, float *left, float *right, int n)
+{
+    int i = 0;
+    for (; i + 8 <= n; i += 8, p += 16) {
+        int16x8_t const v = load_s16be_neon(p);
+        float32x4_t const lo = s16_to_f32_neon(vget_low_s16(v));
+        float32x4_t const hi = s16_to_f32_neon(vget_high_s16(v));
+        vst1q_f32(left + i, lo);
+        vst1q_f32(left + i + 4, hi);
+        vst1q_f32(right + i, lo);
+        vst1q_f32(right + i + 4, hi);
+    }
+    return i;
+}
+
+static int s16be_s16_neon(uint8_t const *p, int16_t *out, int n)
+{
+    int i = 0;
+    for (; i + 8 <= n; i += 8, p += 16) {
+        vst1q_s16(out + i, load_s16be_neon(p));
+    }
+    return i;
+}
+
+static int s16be_s16_deinterleave_neon(uint8_t const *p, int16_t *left, int16_t *right, int n)
+{
+    int i = 0;
+    for (; i + 8 <= n; i += 8, p += 32) {
+        int16x8x2_t const v = vld2q_s16(reinterpret_cast<int16_t const *>(p));
+        vst1q_s16(left + i, vreinterpretq_s16_u8(vrev16q_u8(vreinterpretq_u8_s16(v.val[0]))));
+        vst1q_s16(right + i, vreinterpretq_s16_u8(vrev16q_u8(vreinterpretq_u8_s16(v.val[1]))));
+    }
+    return i;
+}
+
+static int s16be_s16_dup_neon(uint8_t const *p, int16_t *left, int16_t *right, int n)
+{
+    int i = 0;
+    for (; i + 8 <= n; i += 8, p += 16) {
+        int16x8_t const v = load_s16be_neon(p);
+        vst1q_s16(left + i, v);
+        vst1q_s16(right + i, v);
+    }
+    return i;
+}
+
+static int s16le_f32_neon(uint8_t const *p, float *out, int n)
+{
+    int i = 0;
+    for (; i + 8 <= n; i += 8, p += 16) {
+        int16x8_t const v = vreinterpretq_s16_u8(vld1q_u8(p));
+        vst1q_f32(out + i, s16_to_f32_neon(vget_low_s16(v)));
+        vst1q_f32(out + i + 4, s16_to_f32_neon(vget_high_s16(v)));
+    }
+    return i;
+}
+
+static int s8_f32_neon(uint8_t const *p, float *out, int n)
+{
+    float32x4_t const scale = vdupq_n_f32(Scale8);
+    int i = 0;
+    for (; i + 8 <= n; i += 8, p += 8) {
+        int16x8_t const v = vmovl_s8(vld1_s8(reinterpret_cast<int8_t const *>(p)));
+        vst1q_f32(out + i, vdivq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), scale));
+        vst1q_f32(out + i + 4, vdivq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), scale));
+    }
+    return i;
+}
+
+static int s8_s16_neon(uint8_t const *p, int16_t *out, int n)
+{
+    int i = 0;
+    for (; i + 8 <= n; i += 8, p += 8) {
+        vst1q_s16(out + i, vshlq_n_s16(vmovl_s8(vld1_s8(reinterpret_cast<int8_t const *>(p))), 8));
+    }
+    return i;
+}
+
+// 24 bytes of 12-bit packed big-endian samples -> 16 host order shorts
+static inline int16x8x2_t load_s12be_neon(uint8_t const *p)
+{
+    uint8x8x3_t const b = vld3_u8(p);
+    // even samples: b0 and the top nibble of b1; odd samples: bottom nibble of b1 and b2
+    int16x8_t const even = vreinterpretq_s16_u16(
+        vorrq_u16(vshll_n_u8(b.val[0], 8), vmovl_u8(vand_u8(b.val[1], vdup_n_u8(0xf0)))));
+    int16x8_t const odd = vreinterpretq_s16_u16(
+        vorrq_u16(vshll_n_u8(b.val[1], 8), vmovl_u8(b.val[2])));
+    int16x8x2_t r;
+    r.val[0] = vshrq_n_s16(even, 4);
+    r.val[1] = vshrq_n_s16(vshlq_n_s16(odd, 4), 4);
+    return r;
+}
+
+static int s12be_f32_neon(uint8_t const *p, float *out, int n)
+{
+    float32x4_t const scale = vdupq_n_f32(Scale12);
+    int i = 0;
+    for (; i + 16 <= n; i += 16, p += 24) {
+        int16x8x2_t const v = load_s12be_neon(p);
+        float32x4x2_t f;
+        f.val[0] = vdivq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v.val[0]))), scale);
+        f.val[1] = vdivq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v.val[1]))), scale);
+        vst2q_f32(out + i, f);
+        f.val[0] = vdivq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v.val[0]))), scale);
+        f.val[1] = vdivq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v.val[1]))), scale);
+        vst2q_f32(out + i + 8, f);
+    }
+    return i;
+}
+
+static int s12be_s16_neon(uint8_t const *p, int16_t *out, int n)
+{
+    int i = 0;
+    for (; i + 16 <= n; i += 16, p += 24) {
+        int16x8x2_t v = load_s12be_neon(p);
+        v.val[0] = vshlq_n_s16(v.val[0], 4);
+        v.val[1] = vshlq_n_s16(v.val[1], 4);
+        vst2q_s16(out + i, v);
+    }
+    return i;
+}
+
+// 3 Airspy packed words -> 8 host order shorts (see load_airspy12_ssse3)
+static inline int16x8_t load_airspy12_neon(uint8_t const *p)
+{
+    static uint8_t const gather[16] = { 2, 3, 1, 2, 7, 0, 6, 7, 4, 5, 11, 4, 9, 10, 8, 9 };
+    static uint16_t const offset[8] = { 0x8000, 0x0800, 0x8000, 0x0800,
+                                        0x8000, 0x0800, 0x8000, 0x0800 };
+    static uint16_t const even[8] = { 0xffff, 0, 0xffff, 0, 0xffff, 0, 0xffff, 0 };
+    uint16x8_t const v = veorq_u16(vreinterpretq_u16_u8(vqtbl1q_u8(vld1q_u8(p), vld1q_u8(gather))),
+                                   vld1q_u16(offset));
+    int16x8_t const hi = vshrq_n_s16(vreinterpretq_s16_u16(v), 4);
+    int16x8_t const lo = vshrq_n_s16(vshlq_n_s16(vreinterpretq_s16_u16(v), 4), 4);
+    return vbslq_s16(vld1q_u16(even), hi, lo);
+}
+
+static int airspy12_f32_neon(uint8_t const *p, float *out, int n)
+{
+    float32x4_t const scale = vdupq_n_f32(Scale12);
+    int i = 0;
+    for (; i + 11 <= n; i += 8, p += 12) {
+        int16x8_t const v = load_airspy12_neon(p);
+        vst1q_f32(out + i, vdivq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), scale));
+        vst1q_f32(out + i + 4, vdivq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), scale));
+    }
+    return i;
+}
+
+static int airspy12_s16_neon(uint8_t const *p, int16_t *out, int n)
+{
+    int i = 0;
+    for (; i + 11 <= n; i += 8, p += 12) {
+        vst1q_s16(out + i, vshlq_n_s16(load_airspy12_neon(p), 4));
+    }
+    return i;
+}
+
+#endif /* RTP_CONVERT_NEON */
+
+
+// Dispatchers: vector bulk first, scalar tail
+
+void convert_s16be_f32(void const *in, float *out, int n)
+{
+    auto p = static_cast<uint8_t const *>(in);
+    int done = 0;
+#if defined(RTP_CONVERT_AVX2)
+    if (have_avx2()) {
+        done = s16be_f32_avx2(p, out, n);
+    }
+#endif
+#if defined(RTP_CONVERT_SSE2)
+    done += s16be_f32_sse2(p + 2 * done, out + done, n - done);
+#elif defined(RTP_CONVERT_NEON)
+    done = s16be_f32_neon(p, out, n);
+#endif
+    convert_generic::s16be_f32(p + 2 * done, out + done, n - done);
+}
+
+void convert_s16be_cf32_real(void const *in, float *out, int n)
+{
+    auto p = static_cast<uint8_t const *>(in);
+    int done = 0;
+#if defined(RTP_CONVERT_SSE2)
+    done = s16be_cf32_real_sse2(p, out, n);
+#elif defined(RTP_CONVERT_NEON)
+    done = s16be_cf32_real_neon(p, out, n);
+#endif
+    convert_generic::s16be_cf32_real(p + 2 * done, out + 2 * done, n - done);
+}
+
+void convert_s16be_f32_deinterleave(void const *in, float *left, float *right, int n)
+{
+    auto p = static_cast<uint8_t const *>(in);
+    int done = 0;
+#if defined(RTP_CONVERT_SSE2)
+    done = s16be_f32_deinterleave_sse2(p, left, right, n);
+#elif defined(RTP_CONVERT_NEON)
+    done = s16be_f32_deinterleave_neon(p, left, right, n);
+#endif
+    convert_generic::s16be_f32_deinterleave(p + 4 * done, left + done, right + done, n - done);
+}
+
+void convert_s16be_f32_downmix(void const *in, float *out, int n)
+{
+    auto p = static_cast<uint8_t const *>(in);
+    int done = 0;
+#if defined(RTP_CONVERT_SSE2)
+    done = s16be_f32_downmix_sse2(p, out, n);
+#elif defined(RTP_CONVERT_NEON)
+    done = s16be_f32_downmix_neon(p, out, n);
+#endif
+    convert_generic::s16be_f32_downmix(p + 4 * done, out + done, n - done);
+}
+
+void convert_s16be_f32_dup(void const *in, float *left, float *right, int n)
+{
+    auto p = static_cast<uint8_t const *>(in);
+    int done = 0;
+#if defined(RTP_CONVERT_SSE2)
+    done = s16be_f32_dup_sse2(p, left, right, n);
+#elif defined(RTP_CONVERT_NEON)
+    done = s16be_f32_dup_neon(p, left, right, n);
+#endif
+    convert_generic::s16be_f32_dup(p + 2 * done, left + done, right + done, n - done);
+}
+
+void convert_s16be_s16(void const *in, int16_t *out, int n)
+{
+    auto p = static_cast<uint8_t const *>(in);
+    int done = 0;
+#if defined(RTP_CONVERT_AVX2)
+    if (have_avx2()) {
+        done = s16be_s16_avx2(p, out, n);
+    }
+#endif
+#if defined(RTP_CONVERT_SSE2)
+    done += s16be_s16_sse2(p + 2 * done, out + done, n - done);
+#elif defined(RTP_CONVERT_NEON)
+    done = s16be_s16_neon(p, out, n);
+#endif
+    convert_generic::s16be_s16(p + 2 * done, out + done, n - done);
+}
+
+void convert_s16be_s16_deinterleave(void const *in, int16_t *left, int16_t *right, int n)
+{
+    auto p = static_cast<uint8_t const *>(in);
+    int done = 0;
+#if defined(RTP_CONVERT_SSE2)
+    done = s16be_s16_deinterleave_sse2(p, left, right, n);
+#elif defined(RTP_CONVERT_NEON)
+    done = s16be_s16_deinterleave_neon(p, left, right, n);
+#endif
+    convert_generic::s16be_s16_deinterleave(p + 4 * done, left + done, right + done, n - done);
+}
+
+void convert_s16be_s16_dup(void const *in, int16_t *left, int16_t *right, int n)
+{
+    auto p = static_cast<uint8_t const *>(in);
+    int done = 0;
+#if defined(RTP_CONVERT_SSE2)
+    done = s16be_s16_dup_sse2(p, left, right, n);
+#elif defined(RTP_CONVERT_NEON)
+    done = s16be_s16_dup_neon(p, left, right, n);
+#endif
+    convert_generic::s16be_s16_dup(p + 2 * done, left + done, right + done, n - done);
+}
+
+void decode_f32(encoding enc, void const *in, float *out, int n)
+{
+    auto p = static_cast<uint8_t const *>(in);
+    int done = 0;
+    switch (enc) {
+    case encoding::S16BE:
+        convert_s16be_f32(in, out, n);
+        return;
+    case encoding::S16LE:
+#if defined(RTP_CONVERT_SSE2)
+        done = s16le_f32_sse2(p, out, n);
+#elif defined(RTP_CONVERT_NEON)
+        done = s16le_f32_neon(p, out, n);
+#endif
+        convert_generic::decode_f32(enc, p + 2 * done, out + done, n - done);
+        return;
+    case encoding::S8:
+#if defined(RTP_CONVERT_SSE2)
+        done = s8_f32_sse2(p, out, n);
+#elif defined(RTP_CONVERT_NEON)
+        done = s8_f32_neon(p, out, n);
+#endif
+        convert_generic::decode_f32(enc, p + done, out + done, n - done);
+        return;
+    case encoding::S12BE:
+#if defined(RTP_CONVERT_SSSE3)
+        if (have_ssse3()) {
+            done = s12be_f32_ssse3(p, out, n);
+        }
+#elif defined(RTP_CONVERT_NEON)
+        done = s12be_f32_neon(p, out, n);
+#endif
+        // done is even, so the tail starts on a byte boundary
+        convert_generic::decode_f32(enc, p + 3 * done / 2, out + done, n - done);
+        return;
+    case encoding::AIRSPY12:
+#if defined(RTP_CONVERT_SSSE3)
+        if (have_ssse3()) {
+            done = airspy12_f32_ssse3(p, out, n);
+        }
+#elif defined(RTP_CONVERT_NEON)
+        done = airspy12_f32_neon(p, out, n);
+#endif
+        // done is a multiple of 8, so the tail starts on a word group
+        convert_generic::decode_f32(enc, p + 3 * done / 2, out + done, n - done);
+        return;
+    case encoding::F32LE:
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        memcpy(out, in, n * sizeof(float));
+#else
+        convert_generic::decode_f32(enc, in, out, n);
+#endif
+        return;
+    default:
+        return;
+    }
+}
+
+void decode_s16(encoding enc, void const *in, int16_t *out, int n)
+{
+    auto p = static_cast<uint8_t const *>(in);
+    int done = 0;
+    switch (enc) {
+    case encoding::S16BE:
+        convert_s16be_s16(in, out, n);
+        return;
+    case encoding::S16LE:
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        memcpy(out, in, n * sizeof(int16_t));
+#else
+        convert_generic::decode_s16(enc, in, out, n);
+#endif
+        return;
+    case encoding::S8:
+#if defined(RTP_CONVERT_SSE2)
+        done = s8_s16_sse2(p, out, n);
+#elif defined(RTP_CONVERT_NEON)
+        done = s8_s16_neon(p, out, n);
+#endif
+        convert_generic::decode_s16(enc, p + done, out + done, n - done);
+        return;
+    case encoding::S12BE:
+#if defined(RTP_CONVERT_SSSE3)
+        if (have_ssse3()) {
+            done = s12be_s16_ssse3(p, out, n);
+        }
+#elif defined(RTP_CONVERT_NEON)
+        done = s12be_s16_neon(p, out, n);
+#endif
+        convert_generic::decode_s16(enc, p + 3 * done / 2, out + done, n - done);
+        return;
+    case encoding::AIRSPY12:
+#if defined(RTP_CONVERT_SSSE3)
+        if (have_ssse3()) {
+            done = airspy12_s16_ssse3(p, out, n);
+        }
+#elif defined(RTP_CONVERT_NEON)
+        done = airspy12_s16_neon(p, out, n);
+#endif
+        convert_generic::decode_s16(enc, p + 3 * done / 2, out + done, n - done);
+        return;
+    default:
+        // F32LE is scaled and clipped one sample at a time
+        convert_generic::decode_s16(enc, in, out, n);
+        return;
+    }
+}
+
+// Encoders: plain loops, which the compiler vectorizes
+
+static inline void put_s16be(uint8_t *p, int16_t s)
+{
+    p[0] = static_cast<uint16_t>(s) >> 8;
+    p[1] = static_cast<uint16_t>(s);
+}
+
+// Scale, clip and round half away from zero
+static inline int16_t f32_to_s16(float f)
+{
+    float const v = std::min(std::max(f * Scale, -32768.0f), 32767.0f);
+    return static_cast<int16_t>(v + (v >= 0.0f ? 0.5f : -0.5f));
+}
+
+void encode_f32_s16be(float const *in, void *out, int n)
+{
+    auto p = static_cast<uint8_t *>(out);
+    for (int i = 0; i < n; i++, p += 2) {
+        put_s16be(p, f32_to_s16(in[i]));
+    }
+}
+
+void encode_cf32_s16be_real(float const *in, void *out, int n)
+{
+    auto p = static_cast<uint8_t *>(out);
+    for (int i = 0; i < n; i++, p += 2) {
+        put_s16be(p, f32_to_s16(in[2 * i]));
+    }
+}
+
+void encode_f32_s16be_interleave(float const *left, float const *right, void *out, int n)
+{
+    auto p = static_cast<uint8_t *>(out);
+    for (int i = 0; i < n; i++, p += 4) {
+        put_s16be(p, f32_to_s16(left[i]));
+        put_s16be(p + 2, f32_to_s16(right[i]));
+    }
+}
+
+void encode_f32_s16be_downmix(float const *left, float const *right, void *out, int n)
+{
+    auto p = static_cast<uint8_t *>(out);
+    for (int i = 0; i < n; i++, p += 2) {
+        put_s16be(p, f32_to_s16((left[i] + right[i]) * 0.5f));
+    }
+}
+
+void encode_f32_s16be_dup(float const *in, void *out, int n)
+{
+    auto p = static_cast<uint8_t *>(out);
+    for (int i = 0; i < n; i++, p += 4) {
+        int16_t const s = f32_to_s16(in[i]);
+        put_s16be(p, s);
+        put_s16be(p + 2, s);
+    }
+}
+
+void encode_s16_s16be(int16_t const *in, void *out, int n)
+{
+    auto p = static_cast<uint8_t *>(out);
+    for (int i = 0; i < n; i++, p += 2) {
+        put_s16be(p, in[i]);
+    }
+}
+
+void encode_s16_s16be_interleave(int16_t const *left, int16_t const *right, void *out, int n)
+{
+    auto p = static_cast<uint8_t *>(out);
+    for (int i = 0; i < n; i++, p += 4) {
+        put_s16be(p, left[i]);
+        put_s16be(p + 2, right[i]);
+    }
+}
+
+} // namespace rtp
+} // namespace gr
@@ -0,0 +1,112 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 Franco Venturi.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_RTP_CONVERT_H
+#define INCLUDED_RTP_CONVERT_H
+
+#include <cstdint>
+
+namespace gr {
+namespace rtp {
+
+// Sample conversion kernels for RTP payloads
+// Input is the raw payload (16-bit big-endian samples, any alignment);
+// float results are scaled to [-1;1] by dividing by 32767, exactly like the
+// original scalar code, so every variant is bit-exact with convert_generic.
+// The vectorized variants (AVX2/SSE2/NEON) are picked at run time.
+//
+// n is the number of samples for the plain conversions,
+// and the number of stereo frames (or mono samples) for the others.
+
+// samples -> floats (mono, or I/Q into interleaved complex)
+void convert_s16be_f32(void const *in, float *out, int n);
+// mono samples -> complex with zero imaginary part (out has 2*n floats)
+void convert_s16be_cf32_real(void const *in, float *out, int n);
+// stereo frames -> left and right floats
+void convert_s16be_f32_deinterleave(void const *in, float *left, float *right, int n);
+// stereo frames -> mono floats, (left + right) / 2
+void convert_s16be_f32_downmix(void const *in, float *out, int n);
+// mono samples -> the same floats on both outputs (pseudo-stereo)
+void convert_s16be_f32_dup(void const *in, float *left, float *right, int n);
+// samples -> host order shorts
+void convert_s16be_s16(void const *in, int16_t *out, int n);
+// stereo frames -> left and right shorts
+void convert_s16be_s16_deinterleave(void const *in, int16_t *left, int16_t *right, int n);
+// mono samples -> the same shorts on both outputs (pseudo-stereo)
+void convert_s16be_s16_dup(void const *in, int16_t *left, int16_t *right, int n);
+
+// Encoders for the sink: host order samples -> 16-bit big-endian payload
+// Floats are scaled by 32767, rounded and clipped to the 16-bit range, so
+// the samples decoded by the kernels above encode back to the same payload.
+// n is the number of samples for the plain conversions,
+// and the number of frames for the others.
+
+// floats -> samples (mono, or interleaved complex as I/Q)
+void encode_f32_s16be(float const *in, void *out, int n);
+// complex -> mono samples of the real part (in has 2*n floats)
+void encode_cf32_s16be_real(float const *in, void *out, int n);
+// left and right floats -> stereo frames
+void encode_f32_s16be_interleave(float const *left, float const *right, void *out, int n);
+// left and right floats -> mono samples, (left + right) / 2
+void encode_f32_s16be_downmix(float const *left, float const *right, void *out, int n);
+// mono floats -> stereo frames with the same sample on both channels
+void encode_f32_s16be_dup(float const *in, void *out, int n);
+// host order shorts -> samples
+void encode_s16_s16be(int16_t const *in, void *out, int n);
+// left and right shorts -> stereo frames
+void encode_s16_s16be_interleave(int16_t const *left, int16_t const *right, void *out, int n);
+
+// RTP payload sample encodings
+enum class encoding {
+    S16BE, // 16-bit big-endian (standard PCM)
+    S16LE, // 16-bit little-endian
+    S8,    // 8-bit signed
+    S12BE, // 12-bit signed, packed big-endian (2 samples in 3 bytes)
+    F32LE, // 32-bit little-endian float
+    AIRSPY12, // 12-bit offset-2048, 8 samples packed in 3 little-endian 32-bit words
+    NONE,  // not supported (e.g. Opus)
+};
+
+// Sample encoding and channel count of an RTP payload type
+struct payload_format {
+    encoding enc;
+    int channels; // 0 = not defined by the payload type
+    int bits;     // bits per sample
+};
+
+// Format for RTP payload type pt; unknown types are assumed to be 16-bit PCM
+// (with channels 0, like the payload types of unsupported encodings)
+payload_format payload_format_from_pt(int pt);
+
+// Number of whole samples in a payload of size bytes
+int payload_samples(encoding enc, int size);
+
+// Unpack n samples of the given encoding to host order floats in [-1;1]
+// (full scale: 32767 for 16 bits, 127 for 8 bits, 2048 for 12 bits)
+// The output may not overlap the input
+void decode_f32(encoding enc, void const *in, float *out, int n);
+// Unpack n samples of the given encoding to host order shorts
+void decode_s16(encoding enc, void const *in, int16_t *out, int n);
+
+// Plain scalar versions of the kernels above, for reference and testing
+namespace convert_generic {
+void s16be_f32(void const *in, float *out, int n);
+void s16be_cf32_real(void const *in, float *out, int n);
+void s16be_f32_deinterleave(void const *in, float *left, float *right, int n);
+void s16be_f32_downmix(void const *in, float *out, int n);
+void s16be_f32_dup(void const *in, float *left, float *right, int n);
+void s16be_s16(void const *in, int16_t *out, int n);
+void s16be_s16_deinterleave(void const *in, int16_t *left, int16_t *right, int n);
+void s16be_s16_dup(void const *in, int16_t *left, int16_t *right, int n);
+void decode_f32(encoding enc, void const *in, float *out, int n);
+void decode_s16(encoding enc, void const *in, int16_t *out, int n);
+} // namespace convert_generic
+
+} // namespace rtp
+} // namespace gr
+
+#endif /* INCLUDED_RTP_CONVERT_H */
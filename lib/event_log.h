@@ -0,0 +1,98 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 Franco Venturi.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_RTP_EVENT_LOG_H
+#define INCLUDED_RTP_EVENT_LOG_H
+
+#include <gnuradio/logger.h>
+
+#include <chrono>
+#include <cstdint>
+
+namespace gr {
+namespace rtp {
+
+// Rate-limited reporting of the receive path events
+// Gaps, out of order packets, truncated output and datagrams too big for the
+// receive buffers are counted as they
+// happen, and reported at most once per Interval, one line per kind of
+// event with the totals since the last report: a burst of loss costs a few
+// counter updates per packet instead of a log line each. The first event
+// after a quiet interval is reported right away. Nothing is formatted, or
+// even passed to the logger, when its level would discard the line.
+class event_log
+{
+public:
+    static constexpr int Interval = 10; // seconds
+
+    enum event { Gap, Out_of_order, Truncated, Oversize, Num_events };
+
+    explicit event_log(const gr::logger_ptr& logger)
+        : logger(logger), counts{}, samples{}, pending(false)
+    {
+    }
+
+    // Count one event, involving nsamples samples
+    void record(event e, uint64_t nsamples)
+    {
+        counts[e]++;
+        samples[e] += nsamples;
+        pending = true;
+        poll();
+    }
+
+    // Report what has been counted, if it is time to; cheap when there's nothing
+    void poll()
+    {
+        if (pending) {
+            auto const now = clock::now();
+            if (now >= next_report) {
+                report(now);
+            }
+        }
+    }
+
+private:
+    typedef std::chrono::steady_clock clock;
+
+    void report(clock::time_point now)
+    {
+        gr::log_level const level = logger->get_level();
+        if (counts[Gap] > 0 && level <= gr::log_level::info) {
+            logger->info("Dropped {} samples in {} gap(s)", samples[Gap], counts[Gap]);
+        }
+        if (counts[Out_of_order] > 0 && level <= gr::log_level::info) {
+            logger->info("{} out of order packet(s) - {} samples discarded",
+                         counts[Out_of_order], samples[Out_of_order]);
+        }
+        if (counts[Truncated] > 0 && level <= gr::log_level::warn) {
+            logger->warn("work buffer not large enough - dropped {} samples {} time(s)",
+                         samples[Truncated], counts[Truncated]);
+        }
+        if (counts[Oversize] > 0 && level <= gr::log_level::warn) {
+            logger->warn("Dropped {} datagram(s) bigger than the receive buffers",
+                         samples[Oversize]);
+        }
+        for (int e = 0; e < Num_events; e++) {
+            counts[e] = 0;
+            samples[e] = 0;
+        }
+        pending = false;
+        next_report = now + std::chrono::seconds(Interval);
+    }
+
+    gr::logger_ptr logger;
+    uint64_t counts[Num_events];
+    uint64_t samples[Num_events];
+    bool pending;
+    clock::time_point next_report; // epoch: report the first event right away
+};
+
+} // namespace rtp
+} // namespace gr
+
+#endif /* INCLUDED_RTP_EVENT_LOG_H */
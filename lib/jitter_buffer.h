@@ -0,0 +1,136 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 Franco Venturi.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_RTP_JITTER_BUFFER_H
+#define INCLUDED_RTP_JITTER_BUFFER_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "packet_arena.h"
+#include "rtp_info.h"
+
+namespace gr {
+namespace rtp {
+
+// Reorder buffer for one RTP stream
+// Holds copies of up to depth packets (payloads of up to slot_size bytes, in
+// an arena allocated up front), indexed by their RTP sequence number
+// relative to the next one due for playout (the head). Packets are taken out
+// in sequence order; what to do about a missing head packet (a hole) is up
+// to the caller.
+class jitter_buffer
+{
+public:
+    typedef std::chrono::steady_clock clock;
+
+    struct entry {
+        bool used;
+        rtp_info rtp;
+        int size;
+        clock::time_point arrival;
+        uint8_t *data;
+    };
+
+    explicit jitter_buffer(int depth, int slot_size = Packet_slot_size)
+        : d_entries(depth),
+          d_data(depth, slot_size),
+          d_head(0),
+          d_count(0),
+          d_next(0)
+    {
+        for (int i = 0; i < depth; i++) {
+            d_entries[i].used = false;
+            d_entries[i].data = d_data.slot(i);
+        }
+    }
+
+    // Empty the buffer; seq is the next packet due
+    void reset(uint16_t seq)
+    {
+        for (auto& e : d_entries) {
+            e.used = false;
+        }
+        d_head = 0;
+        d_count = 0;
+        d_next = seq;
+    }
+
+    int depth() const { return d_entries.size(); }
+    int count() const { return d_count; }
+    int slot_size() const { return d_data.slot_size(); }
+    bool empty() const { return d_count == 0; }
+
+    // Position of seq relative to the head (< 0 = already played or skipped)
+    int offset(uint16_t seq) const { return static_cast<int16_t>(seq - d_next); }
+
+    // Packet held at 0 <= offset < depth(), or NULL
+    entry const *at(int offset) const
+    {
+        entry const& e = d_entries[(d_head + offset) % d_entries.size()];
+        return e.used ? &e : NULL;
+    }
+
+    entry const *head() const { return at(0); }
+
+    // Keep a copy of the packet at 0 <= offset < depth() (size <= slot_size())
+    void store(int offset,
+               rtp_info const& rtp,
+               uint8_t const *dp,
+               int size,
+               clock::time_point arrival)
+    {
+        entry& e = d_entries[(d_head + offset) % d_entries.size()];
+        e.used = true;
+        e.rtp = rtp;
+        e.size = size;
+        e.arrival = arrival;
+        memcpy(e.data, dp, e.size);
+        d_count++;
+    }
+
+    // Move the head past the current packet or hole
+    void advance()
+    {
+        entry& e = d_entries[d_head];
+        if (e.used) {
+            e.used = false;
+            d_count--;
+        }
+        d_head = (d_head + 1) % d_entries.size();
+        d_next++;
+    }
+
+    // Move the head n packets forward (buffer must be empty)
+    void skip(int n) { d_next += n; }
+
+    // Arrival time of the oldest packet held: how long the head hole has been known
+    clock::time_point oldest_arrival() const
+    {
+        clock::time_point oldest = clock::time_point::max();
+        for (auto const& e : d_entries) {
+            if (e.used && e.arrival < oldest) {
+                oldest = e.arrival;
+            }
+        }
+        return oldest;
+    }
+
+private:
+    std::vector<entry> d_entries;
+    packet_arena d_data;
+    size_t d_head;  // entry of the next packet due
+    int d_count;    // packets held
+    uint16_t d_next; // sequence number of the next packet due
+};
+
+} // namespace rtp
+} // namespace gr
+
+#endif /* INCLUDED_RTP_JITTER_BUFFER_H */
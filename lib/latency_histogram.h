@@ -0,0 +1,98 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 Franco Venturi.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_RTP_LATENCY_HISTOGRAM_H
+#define INCLUDED_RTP_LATENCY_HISTOGRAM_H
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
+namespace gr {
+namespace rtp {
+
+// Lock-free latency histogram: a single writer records, anyone can read
+// Log-linear buckets of nanoseconds: 8 per power of 2, so percentiles are
+// within 12.5% of the true value, from 1 ns up to the whole int64 range.
+class latency_histogram
+{
+public:
+    latency_histogram() { reset(); }
+
+    // Writer only: no read-modify-write needed
+    void record(int64_t ns)
+    {
+        std::atomic<uint64_t>& c = d_counts[bucket(ns < 0 ? 0 : ns)];
+        c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    // Counts recorded concurrently with a reset may survive it
+    void reset()
+    {
+        for (auto& c : d_counts) {
+            c.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    uint64_t count() const
+    {
+        uint64_t n = 0;
+        for (auto const& c : d_counts) {
+            n += c.load(std::memory_order_relaxed);
+        }
+        return n;
+    }
+
+    // Latency (ns) below which fraction q (0..1) of the samples fall; 0 if empty
+    double quantile(double q) const
+    {
+        uint64_t const n = count();
+        if (n == 0) {
+            return 0;
+        }
+        uint64_t const rank = std::max<uint64_t>(1, std::ceil(q * n));
+        uint64_t seen = 0;
+        for (int i = 0; i < Buckets; i++) {
+            seen += d_counts[i].load(std::memory_order_relaxed);
+            if (seen >= rank) {
+                return (lower_bound(i) + lower_bound(i + 1)) / 2.0; // bucket middle
+            }
+        }
+        return lower_bound(Buckets);
+    }
+
+private:
+    static int const Sub_bits = 3;
+    static int const Sub = 1 << Sub_bits;
+    static int const Buckets = Sub + (63 - Sub_bits) * Sub;
+
+    static int bucket(uint64_t ns)
+    {
+        if (ns < Sub) {
+            return ns;
+        }
+        int const e = 63 - __builtin_clzll(ns) - Sub_bits;
+        return Sub + e * Sub + ((ns >> e) & (Sub - 1));
+    }
+
+    static double lower_bound(int i)
+    {
+        if (i < Sub) {
+            return i;
+        }
+        int const e = (i - Sub) / Sub;
+        return std::ldexp(Sub + (i - Sub) % Sub, e);
+    }
+
+    std::atomic<uint64_t> d_counts[Buckets];
+};
+
+} // namespace rtp
+} // namespace gr
+
+#endif /* INCLUDED_RTP_LATENCY_HISTOGRAM_H */
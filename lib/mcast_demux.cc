@@ -0,0 +1,213 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 Franco Venturi.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "mcast_demux.h"
+
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "multicast.h"
+#include "rtp_info.h"
+
+namespace gr {
+namespace rtp {
+
+gr::thread::mutex mcast_demux::s_registry_mutex;
+std::map<std::string, std::weak_ptr<mcast_demux>> mcast_demux::s_registry;
+
+mcast_demux::sptr mcast_demux::get(const std::string& mcast_address,
+                                   int batch_size,
+                                   bool async_join,
+                                   bool io_uring)
+{
+    gr::thread::scoped_lock lock(s_registry_mutex);
+    auto demux = s_registry[mcast_address].lock();
+    if (!demux) {
+        demux = sptr(new mcast_demux(mcast_address, batch_size, async_join, io_uring));
+        s_registry[mcast_address] = demux;
+    } else if (batch_size != demux->d_batch_size || async_join != demux->d_async_join ||
+               io_uring != demux->d_io_uring) {
+        auto logger = std::make_shared<gr::logger>("rtp_mcast_demux");
+        logger->warn("{} already open with batch_size={} async_join={} io_uring={} - "
+                     "ignoring batch_size={} async_join={} io_uring={}",
+                     mcast_address, demux->d_batch_size, demux->d_async_join,
+                     demux->d_io_uring, batch_size, async_join, io_uring);
+    }
+    return demux;
+}
+
+mcast_demux::mcast_demux(const std::string& mcast_address,
+                         int batch_size,
+                         bool async_join,
+                         bool io_uring)
+    : d_address(mcast_address),
+      d_batch_size(batch_size),
+      d_async_join(async_join),
+      d_io_uring(io_uring),
+      d_fd(-1),
+      d_timestamps(false),
+      d_slot_size(Packet_slot_size),
+      d_rx(std::max(batch_size, 1), 0, true),
+      d_stop(false)
+{
+    auto logger = std::make_shared<gr::logger>("rtp_mcast_demux");
+    if (async_join) {
+        // Read from a placeholder until the group is joined in the background
+        // (the interface isn't known yet: keep room for jumbograms)
+        d_fd = mcast_joiner::placeholder();
+    } else {
+        mcast_target target;
+        d_fd = mcast_resolver::setup_input(mcast_address, logger, &target);
+        d_slot_size = packet_arena::slot_size_for(
+            target.iface.empty() ? Default_mcast_iface : target.iface.c_str());
+    }
+    if (d_fd == -1) {
+        throw std::runtime_error(std::string("Can't set up input from \"") +
+                                 mcast_address + "\"");
+    }
+    configure(d_fd);
+    d_rx.allocate(d_slot_size);
+    if (async_join) {
+        d_joiner = std::make_unique<mcast_joiner>(
+            mcast_address, d_fd, [this](int fd) { configure(fd); }, logger,
+            [this] { d_wake.notify(); });
+    } else if (io_uring) {
+        // Room for the timestamps, in case a subscriber asks for them later
+        d_uring = uring_rx::open(d_fd, d_rx.size(), true, logger);
+        if (d_uring) {
+            d_slot_size = uring_rx::Payload_size; // its buffers take jumbograms
+        }
+    }
+
+    d_thread = gr::thread::thread([this] { receiver(); });
+}
+
+mcast_demux::~mcast_demux()
+{
+    d_stop = true;
+    if (d_uring) {
+        d_uring->wakeup();
+    }
+    d_wake.notify();
+    d_thread.join();
+    d_joiner.reset();
+    d_uring.reset();
+    close(d_fd);
+
+    gr::thread::scoped_lock lock(s_registry_mutex);
+    auto it = s_registry.find(d_address);
+    if (it != s_registry.end() && it->second.expired()) {
+        s_registry.erase(it);
+    }
+}
+
+void mcast_demux::enable_timestamps()
+{
+    d_timestamps = true;
+    configure(d_fd);
+}
+
+// Socket options for the input (and for every socket joined in the background)
+void mcast_demux::configure(int fd)
+{
+    if (d_timestamps) {
+        int const on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on));
+    }
+}
+
+void mcast_demux::subscribe(uint32_t ssrc, const std::shared_ptr<packet_ring>& ring)
+{
+    unsubscribe(ring);
+    gr::thread::scoped_lock lock(d_mutex);
+    d_subscribers[ssrc].push_back(ring);
+}
+
+void mcast_demux::unsubscribe(const std::shared_ptr<packet_ring>& ring)
+{
+    gr::thread::scoped_lock lock(d_mutex);
+    for (auto it = d_subscribers.begin(); it != d_subscribers.end();) {
+        auto& rings = it->second;
+        rings.erase(std::remove(rings.begin(), rings.end(), ring), rings.end());
+        if (rings.empty()) {
+            it = d_subscribers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void mcast_demux::receiver()
+{
+    while (!d_stop) {
+        if (d_uring) {
+            // Sleep until packets arrive (or the destructor wakes us up)
+            int const n = d_uring->receive(-1);
+            gr::thread::scoped_lock lock(d_mutex);
+            for (int i = 0; i < n; i++) {
+                dispatch(d_uring->data(i), d_uring->len(i), false, d_uring->sender(i),
+                         d_uring->kernel_ns(i), d_uring->recv_ns());
+            }
+            continue;
+        }
+        int const n = d_rx.receive(d_fd, d_rx.size(), false);
+        if (n == 0) {
+            // Sleep until packets arrive (or the destructor wakes us up)
+            d_wake.wait(d_fd);
+            continue;
+        }
+        gr::thread::scoped_lock lock(d_mutex);
+        for (int i = 0; i < n; i++) {
+            // a truncated datagram still has its header: count it for its SSRC
+            bool const truncated = d_rx.truncated(i);
+            dispatch(d_rx.data(i), truncated ? d_slot_size : d_rx.len(i), truncated,
+                     d_rx.sender(i), d_rx.kernel_ns(i), d_rx.recv_ns());
+        }
+    }
+}
+
+// Copy one datagram to every ring subscribed to its SSRC (called with d_mutex held)
+// A truncated one is only counted, as is one too big for a ring
+void mcast_demux::dispatch(uint8_t const *data, int size, bool truncated,
+                           struct sockaddr const *sender, int64_t kernel_ns, int64_t recv_ns)
+{
+    rtp_info rtp;
+    uint8_t const *dp;
+    if (parse_rtp(data, size, 0, rtp, &dp) <= 0) {
+        return; // Not valid RTP, empty, or SSRC 0
+    }
+
+    for (uint32_t const key : { rtp.ssrc, 0U }) {
+        auto it = d_subscribers.find(key);
+        if (it == d_subscribers.end()) {
+            continue;
+        }
+        for (auto& ring : it->second) {
+            if (truncated || size > ring->slot_size()) {
+                ring->truncation(); // don't decode it as if it were complete
+                continue;
+            }
+            if (ring->writable() == 0) {
+                ring->overrun();
+                continue;
+            }
+            packet_slot *slot = ring->write_slot(0);
+            slot->len = size;
+            memcpy(slot->data, data, size);
+            slot->kernel_ns = kernel_ns;
+            slot->recv_ns = recv_ns;
+            memcpy(&slot->sender, sender, sender->sa_family == AF_INET6 ?
+                   sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in));
+            ring->publish(1);
+        }
+    }
+}
+
+} // namespace rtp
+} // namespace gr
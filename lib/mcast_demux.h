@@ -0,0 +1,99 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 Franco Venturi.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_RTP_MCAST_DEMUX_H
+#define INCLUDED_RTP_MCAST_DEMUX_H
+
+#include <gnuradio/thread/thread.h>
+
+#include <sys/socket.h>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mcast_join.h"
+#include "packet_ring.h"
+#include "rx_batch.h"
+#include "uring_rx.h"
+
+namespace gr {
+namespace rtp {
+
+// Process-wide multicast demultiplexer
+// One socket and one receiver thread per multicast address, shared by all the
+// source blocks reading from it. Each RTP header is parsed once here and the
+// datagram is copied only into the rings of the consumers that want its SSRC.
+// Instances are reference counted: the last owner to go away closes the socket.
+class mcast_demux
+{
+public:
+    typedef std::shared_ptr<mcast_demux> sptr;
+
+    // Return the demux for mcast_address, creating it if needed
+    // async_join = join the group in the background,
+    // io_uring = read the socket through io_uring (when creating it)
+    // The options of the first block to open an address apply to every block
+    // sharing it: a block asking for different ones gets a warning
+    // Throws std::runtime_error if the multicast input can't be set up
+    static sptr get(const std::string& mcast_address,
+                    int batch_size,
+                    bool async_join = false,
+                    bool io_uring = false);
+
+    ~mcast_demux();
+
+    // Deliver the datagrams for ssrc (0 = any SSRC) into ring
+    void subscribe(uint32_t ssrc, const std::shared_ptr<packet_ring>& ring);
+    void unsubscribe(const std::shared_ptr<packet_ring>& ring);
+
+    const std::string& address() const { return d_address; }
+
+    // Largest datagram it delivers: the size for the subscribers' ring slots
+    int slot_size() const { return d_slot_size; }
+
+    // Ask the kernel for receive timestamps (for latency stats)
+    void enable_timestamps();
+
+private:
+    mcast_demux(const std::string& mcast_address, int batch_size, bool async_join, bool io_uring);
+
+    void configure(int fd);
+
+    void receiver();
+    void dispatch(uint8_t const *data, int size, bool truncated, struct sockaddr const *sender,
+                  int64_t kernel_ns, int64_t recv_ns);
+
+    std::string const d_address;
+    int const d_batch_size;
+    bool const d_async_join;
+    bool const d_io_uring;
+    int d_fd;
+    std::unique_ptr<mcast_joiner> d_joiner; // async_join mode
+    std::atomic<bool> d_timestamps;
+    int d_slot_size;
+    rx_batch d_rx;
+    std::unique_ptr<uring_rx> d_uring;
+
+    // SSRC -> consumer rings; SSRC 0 gets everything
+    gr::thread::mutex d_mutex;
+    std::unordered_map<uint32_t, std::vector<std::shared_ptr<packet_ring>>> d_subscribers;
+
+    gr::thread::thread d_thread;
+    std::atomic<bool> d_stop;
+    rx_wakeup d_wake;
+
+    static gr::thread::mutex s_registry_mutex;
+    static std::map<std::string, std::weak_ptr<mcast_demux>> s_registry;
+};
+
+} // namespace rtp
+} // namespace gr
+
+#endif /* INCLUDED_RTP_MCAST_DEMUX_H */
@@ -0,0 +1,250 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 Franco Venturi.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "mcast_join.h"
+
+#include <net/if.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <map>
+#include <memory>
+
+#include "multicast.h"
+
+namespace gr {
+namespace rtp {
+
+// One lookup of a target; lookup becomes ready when it completes
+struct resolve_entry {
+    std::shared_future<bool> lookup;
+    mcast_target target; // valid once lookup is ready and true
+    std::chrono::steady_clock::time_point time;
+};
+
+static gr::thread::mutex resolve_cache_mutex;
+static std::map<std::string, std::shared_ptr<resolve_entry>> resolve_cache;
+
+bool mcast_resolver::resolve(const std::string& target, mcast_target& result, int default_port)
+{
+    if (default_port <= 0) {
+        default_port = DEFAULT_RTP_PORT;
+    }
+    gr::thread::scoped_lock lock(resolve_cache_mutex);
+    auto& cached = resolve_cache[std::to_string(default_port) + " " + target];
+    if (cached) {
+        auto entry = cached;
+        if (entry->lookup.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            // Somebody else is looking it up right now: wait for that
+            lock.unlock();
+            if (!entry->lookup.get()) {
+                return false;
+            }
+            result = entry->target;
+            return true;
+        }
+        if (entry->lookup.get() &&
+            std::chrono::steady_clock::now() - entry->time < std::chrono::seconds(Cache_ttl)) {
+            result = entry->target;
+            return true;
+        }
+    }
+
+    // New lookup, outside the lock
+    auto entry = std::make_shared<resolve_entry>();
+    std::promise<bool> done;
+    entry->lookup = done.get_future().share();
+    cached = entry;
+    lock.unlock();
+
+    char iface[1024];
+    iface[0] = '\0';
+    memset(&entry->target.sock, 0, sizeof(entry->target.sock));
+    bool const ok = resolve_mcast_tries(target.c_str(), &entry->target.sock,
+                                        default_port, iface, sizeof(iface), 1) == 0;
+    entry->target.iface = iface;
+    entry->time = std::chrono::steady_clock::now();
+    done.set_value(ok);
+    if (ok) {
+        result = entry->target;
+    }
+    return ok;
+}
+
+int mcast_resolver::setup_input(const std::string& target,
+                                const gr::logger_ptr& logger,
+                                mcast_target *resolved)
+{
+    mcast_target t;
+    bool retried = false;
+    while (!resolve(target, t)) {
+        if (!retried) {
+            logger->warn("Can't resolve \"{}\" - retrying every 10 sec", target);
+            retried = true;
+        }
+        sleep(10);
+    }
+    if (retried) {
+        logger->info("Resolved \"{}\"", target);
+    }
+    if (resolved != NULL) {
+        *resolved = t;
+    }
+    return listen(t);
+}
+
+int mcast_resolver::listen(const mcast_target& target)
+{
+    char const *iface = target.iface.empty() ? Default_mcast_iface : target.iface.c_str();
+    return listen_mcast(&target.sock, iface);
+}
+
+int mcast_resolver::setup_output(const std::string& target,
+                                 int ttl,
+                                 const gr::logger_ptr& logger,
+                                 mcast_target *resolved)
+{
+    mcast_target t;
+    bool retried = false;
+    while (!resolve(target, t)) {
+        if (!retried) {
+            logger->warn("Can't resolve \"{}\" - retrying every 10 sec", target);
+            retried = true;
+        }
+        sleep(10);
+    }
+    if (retried) {
+        logger->info("Resolved \"{}\"", target);
+    }
+    if (resolved != NULL) {
+        *resolved = t;
+    }
+    return connect(t, ttl);
+}
+
+int mcast_resolver::connect(const mcast_target& target, int ttl)
+{
+    char const *iface = target.iface.empty() ? Default_mcast_iface : target.iface.c_str();
+    int const fd = connect_mcast(&target.sock, iface, ttl, -1);
+    if (fd == -1 || iface == NULL || iface[0] == '\0') {
+        return fd;
+    }
+    // connect_mcast() only joins the group on iface: send there too
+    // instead of following the route to the group
+    int const ifindex = if_nametoindex(iface);
+    if (target.sock.ss_family == AF_INET) {
+        struct ip_mreqn mreqn;
+        memset(&mreqn, 0, sizeof(mreqn));
+        mreqn.imr_ifindex = ifindex;
+        setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &mreqn, sizeof(mreqn));
+    } else {
+        setsockopt(fd, IPPROTO_IPV6, IPV6_MULTICAST_IF, &ifindex, sizeof(ifindex));
+    }
+    return fd;
+}
+
+mcast_joiner::mcast_joiner(const std::string& target,
+                           int fd,
+                           const std::function<void(int)>& configure,
+                           const gr::logger_ptr& logger,
+                           const std::function<void()>& replaced)
+    : d_target(target),
+      d_fd(fd),
+      d_configure(configure),
+      d_replaced(replaced),
+      d_logger(logger),
+      d_stop(false),
+      d_joined(false)
+{
+    memset(&d_joined_sock, 0, sizeof(d_joined_sock));
+    d_thread = gr::thread::thread([this] { run(); });
+}
+
+mcast_joiner::~mcast_joiner()
+{
+    {
+        gr::thread::scoped_lock lock(d_mutex);
+        d_stop = true;
+    }
+    d_cond.notify_all();
+    d_thread.join();
+}
+
+int mcast_joiner::placeholder() { return socket(AF_INET, SOCK_DGRAM, 0); }
+
+void mcast_joiner::run()
+{
+    int backoff = Min_backoff;
+    bool failed = false;
+    gr::thread::scoped_lock lock(d_mutex);
+    while (!d_stop) {
+        lock.unlock();
+        bool const ok = join();
+        lock.lock();
+
+        int wait;
+        if (ok) {
+            if (failed) {
+                d_logger->info("Resolved \"{}\"", d_target);
+            }
+            failed = false;
+            backoff = Min_backoff;
+            wait = Recheck_interval;
+        } else {
+            if (!failed) {
+                d_logger->warn("Can't join \"{}\" - retrying in the background", d_target);
+            }
+            failed = true;
+            wait = backoff;
+            backoff = std::min(2 * backoff, Max_backoff);
+        }
+        d_cond.wait_for(lock, boost::chrono::seconds(wait), [this] { return d_stop; });
+    }
+}
+
+// Resolve the target and, if its address is new, join it
+bool mcast_joiner::join()
+{
+    mcast_target t;
+    if (!mcast_resolver::resolve(d_target, t)) {
+        return false;
+    }
+    if (d_joined && address_match(&t.sock, &d_joined_sock) &&
+        getportnumber(&t.sock) == getportnumber(&d_joined_sock)) {
+        return true; // no change
+    }
+
+    int const fd = mcast_resolver::listen(t);
+    if (fd == -1) {
+        return false;
+    }
+    d_configure(fd);
+    if (dup2(fd, d_fd) == -1) {
+        close(fd);
+        return false;
+    }
+    close(fd);
+    if (d_replaced) {
+        d_replaced();
+    }
+
+    bool const rejoined = d_joined;
+    d_joined_sock = t.sock;
+    d_joined = true;
+    if (rejoined) {
+        d_logger->info("Address of \"{}\" changed - rejoined {}", d_target, formatsock(&t.sock));
+    } else {
+        d_logger->info("Joined \"{}\" at {}", d_target, formatsock(&t.sock));
+    }
+    return true;
+}
+
+} // namespace rtp
+} // namespace gr
@@ -0,0 +1,114 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 Franco Venturi.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_RTP_MCAST_JOIN_H
+#define INCLUDED_RTP_MCAST_JOIN_H
+
+#include <gnuradio/logger.h>
+#include <gnuradio/thread/thread.h>
+
+#include <sys/socket.h>
+#include <atomic>
+#include <functional>
+#include <string>
+
+namespace gr {
+namespace rtp {
+
+// A resolved multicast target "name[:port][,iface]"
+struct mcast_target {
+    struct sockaddr_storage sock;
+    std::string iface; // empty = default interface
+};
+
+// Process-wide cache of multicast name lookups
+// Every block reading the same target shares one result, and concurrent
+// lookups of the same name wait for a single getaddrinfo() (mDNS can take
+// seconds per query). Results are reused for Cache_ttl; failures are not cached.
+class mcast_resolver
+{
+public:
+    static constexpr int Cache_ttl = 60; // seconds
+
+    // Resolve target with a single lookup (or from the cache), with port
+    // default_port if target doesn't have one (0 = the RTP port)
+    // Returns false if the name can't be resolved
+    static bool resolve(const std::string& target, mcast_target& result, int default_port = 0);
+
+    // Open a socket joined to target, retrying the lookup every 10 sec until
+    // it succeeds (like setup_mcast_in()); returns -1 if the socket can't be set up
+    // The address joined is returned in resolved, if not NULL
+    static int setup_input(const std::string& target,
+                           const gr::logger_ptr& logger,
+                           mcast_target *resolved = NULL);
+
+    // Open a socket joined to an already resolved target
+    static int listen(const mcast_target& target);
+
+    // Open a socket connected to target for sending, retrying the lookup like
+    // setup_input(); multicasts go out on the target's interface (if any)
+    // Returns -1 if the socket can't be set up
+    static int setup_output(const std::string& target,
+                            int ttl,
+                            const gr::logger_ptr& logger,
+                            mcast_target *resolved = NULL);
+
+    // Open a socket connected to an already resolved target
+    static int connect(const mcast_target& target, int ttl);
+};
+
+// Background resolve and join of a multicast input
+// The caller receives from fd, which is just an unbound placeholder socket
+// until the group is joined; the joined socket is then dup2()'d onto it, so
+// the receive code never sees the descriptor change (a receiver blocked on
+// the placeholder returns at its SO_RCVTIMEO timeout, or is woken up by the
+// replaced callback if it polls fd with no timeout). Failed lookups are
+// retried with exponential backoff, and the name is looked up again every
+// Recheck_interval to rejoin if its address changes.
+class mcast_joiner
+{
+public:
+    static constexpr int Min_backoff = 1;       // seconds
+    static constexpr int Max_backoff = 64;      // seconds
+    static constexpr int Recheck_interval = 60; // seconds
+
+    // configure is applied to every new socket before it replaces fd
+    // (receive timeout, timestamps, ...); replaced is called right after
+    mcast_joiner(const std::string& target,
+                 int fd,
+                 const std::function<void(int)>& configure,
+                 const gr::logger_ptr& logger,
+                 const std::function<void()>& replaced = nullptr);
+    ~mcast_joiner();
+
+    bool joined() const { return d_joined; }
+
+    // Unbound UDP socket to stand in for the multicast input until it's joined
+    static int placeholder();
+
+private:
+    void run();
+    bool join();
+
+    std::string const d_target;
+    int const d_fd;
+    std::function<void(int)> const d_configure;
+    std::function<void()> const d_replaced;
+    gr::logger_ptr d_logger;
+    struct sockaddr_storage d_joined_sock; // address currently joined
+
+    gr::thread::thread d_thread;
+    gr::thread::mutex d_mutex;
+    gr::thread::condition_variable d_cond;
+    bool d_stop;
+    std::atomic<bool> d_joined;
+};
+
+} // namespace rtp
+} // namespace gr
+
+#endif /* INCLUDED_RTP_MCAST_JOIN_H */
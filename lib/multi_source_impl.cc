@@ -0,0 +1,192 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 Franco Venturi.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "multi_source_impl.h"
+#include <gnuradio/io_signature.h>
+
+#include <unistd.h>
+#include <stdexcept>
+
+namespace gr {
+namespace rtp {
+
+// Config constants
+
+static struct timeval udp_timeout = {0, 100000};   // set timeout to 0.1s
+
+template <typename T>
+typename multi_source<T>::sptr multi_source<T>::make(const std::string& mcast_address,
+                                                     const std::vector<unsigned int>& ssrcs,
+                                                     int num_outputs,
+                                                     int in_channels,
+                                                     bool quiet,
+                                                     int batch_size)
+{
+    return gnuradio::make_block_sptr<multi_source_impl<T>>(mcast_address,
+                                                           ssrcs,
+                                                           num_outputs,
+                                                           in_channels,
+                                                           quiet,
+                                                           batch_size);
+}
+
+template <typename T>
+multi_source_impl<T>::multi_source_impl(const std::string& mcast_address,
+                                        const std::vector<unsigned int>& ssrcs,
+                                        int num_outputs,
+                                        int in_channels,
+                                        bool quiet,
+                                        int batch_size)
+    : gr::block("rtp_multi_source",
+                gr::io_signature::make(0, 0, 0),
+                gr::io_signature::make(ssrcs.empty() ? num_outputs : ssrcs.size(),
+                                       ssrcs.empty() ? num_outputs : ssrcs.size(),
+                                       sizeof(T))),
+      mcast_fd(-1),
+      channels(in_channels),
+      quiet(quiet),
+      allocate_ssrcs(ssrcs.empty()),
+      ssrcs(ssrcs),
+      rx(std::max(batch_size, 1), 0),
+      rx_count(0),
+      rx_next(0),
+      truncations_reported(0)
+{
+    if (allocate_ssrcs) {
+        if (num_outputs < 1) {
+            throw std::runtime_error("at least one output is required");
+        }
+        this->ssrcs.assign(num_outputs, 0);
+    }
+    for (size_t i = 0; i < this->ssrcs.size(); i++) {
+        if (this->ssrcs[i] != 0) {
+            if (outputs.count(this->ssrcs[i]) > 0) {
+                throw std::runtime_error("duplicate SSRC " + std::to_string(this->ssrcs[i]));
+            }
+            outputs[this->ssrcs[i]] = i;
+        }
+        sessions.emplace_back(in_channels, quiet, this->d_logger);
+        sessions.back().set_tags(this, i);
+    }
+    sessions[0].check_out_channels(1);
+    produced.resize(this->ssrcs.size());
+
+    // Set up multicast input
+    mcast_target target;
+    mcast_fd = mcast_resolver::setup_input(mcast_address, this->d_logger, &target);
+    if (mcast_fd == -1) {
+        auto error_message = std::string("Can't set up input from \"") + mcast_address + "\"";
+        this->d_logger->error(error_message);
+        throw std::runtime_error(error_message);
+    }
+    // set UDP socket timeout so it can be interrupted by Boost
+    setsockopt(mcast_fd, SOL_SOCKET, SO_RCVTIMEO, (char*)&udp_timeout, sizeof(udp_timeout));
+
+    // Packet buffers for what the interface can deliver in one piece
+    int const slot_size = packet_arena::slot_size_for(
+        target.iface.empty() ? Default_mcast_iface : target.iface.c_str());
+    rx.allocate(slot_size);
+    for (auto& session : sessions) {
+        session.set_packet_size(slot_size);
+    }
+}
+
+template <typename T>
+multi_source_impl<T>::~multi_source_impl()
+{
+    close(mcast_fd);
+}
+
+// Output index for ssrc, or -1 if we don't want it
+template <typename T>
+int multi_source_impl<T>::find_output(uint32_t ssrc)
+{
+    auto it = outputs.find(ssrc);
+    if (it != outputs.end()) {
+        return it->second;
+    }
+    if (!allocate_ssrcs || outputs.size() == ssrcs.size()) {
+        return -1;
+    }
+    // New SSRC: give it the next free output
+    int const index = outputs.size();
+    {
+        gr::thread::scoped_lock lock(ssrcs_mutex);
+        ssrcs[index] = ssrc;
+    }
+    outputs[ssrc] = index;
+    if (!quiet) {
+        this->d_logger->info("SSRC {} assigned to output {}", ssrc, index);
+    }
+    return index;
+}
+
+template <typename T>
+int multi_source_impl<T>::general_work(int noutput_items,
+                                       gr_vector_int& ninput_items,
+                                       gr_vector_const_void_star& input_items,
+                                       gr_vector_void_star& output_items)
+{
+    auto outs = reinterpret_cast<T**>(&output_items[0]);
+
+    // First what was carried over from the previous call (packets bigger
+    // than the output buffer), then as many queued datagrams as fit
+    std::fill(produced.begin(), produced.end(), 0);
+    bool idle = true;
+    for (size_t i = 0; i < sessions.size(); i++) {
+        sessions[i].drain(outs + i, noutput_items, 1, produced[i]);
+        idle = idle && produced[i] == 0;
+    }
+    while (true) {
+        boost::this_thread::interruption_point();
+        if (rx_next == rx_count) {
+            // Batch exhausted; only block if we have nothing to return yet
+            rx_next = 0;
+            rx_count = rx.receive(mcast_fd, rx.size(), idle);
+            if (rx_count == 0) {
+                break;
+            }
+        }
+
+        uint8_t const *buffer = rx.data(rx_next);
+        int size = rx.len(rx_next);
+
+        rtp_info rtp;
+        uint8_t const *dp;
+        size = parse_rtp(buffer, size, 0, rtp, &dp);
+        int const index = size <= 0 ? -1 : find_output(rtp.ssrc);
+        if (index < 0) {
+            rx_next++;
+            continue; // Ignore invalid or empty packets and unwanted SSRCs
+        }
+
+        if (!sessions[index].process(&rtp, dp, size, rx.sender(rx_next),
+                                     outs + index, noutput_items, 1,
+                                     produced[index])) {
+            break; // Doesn't fit; keep it for the next call
+        }
+        rx_next++;
+        idle = false;
+    }
+
+    uint64_t const truncated = rx.truncations();
+    if (truncated != truncations_reported) {
+        sessions[0].oversize(truncated - truncations_reported);
+        truncations_reported = truncated;
+    }
+
+    for (size_t i = 0; i < produced.size(); i++) {
+        this->produce(i, produced[i]);
+    }
+    return gr::block::WORK_CALLED_PRODUCE;
+}
+
+template class multi_source<gr_complex>;
+template class multi_source<float>;
+template class multi_source<std::int16_t>;
+} /* namespace rtp */
+} /* namespace gr */
@@ -0,0 +1,75 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 Franco Venturi.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_RTP_MULTI_SOURCE_IMPL_H
+#define INCLUDED_RTP_MULTI_SOURCE_IMPL_H
+
+#include <gnuradio/rtp/multi_source.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include "mcast_join.h"
+#include "multicast.h"
+#include "rtp_info.h"
+#include "rx_batch.h"
+#include "session.h"
+
+namespace gr {
+namespace rtp {
+
+template <class T>
+class multi_source_impl : public multi_source<T>
+{
+private:
+    int mcast_fd;
+    int channels;
+    bool quiet;
+    bool allocate_ssrcs; // assign outputs in order of appearance
+
+    // one session per output, and SSRC -> output index
+    std::vector<session<T>> sessions;
+    std::unordered_map<uint32_t, int> outputs;
+    std::vector<unsigned int> ssrcs;
+    mutable gr::thread::mutex ssrcs_mutex;
+    std::vector<int> produced; // per output, in general_work()
+
+    // recvmmsg() batch
+    rx_batch rx;
+    int rx_count; // datagrams in current batch
+    int rx_next;  // next datagram to process
+    uint64_t truncations_reported; // datagrams too big for the buffers, logged so far
+
+public:
+    multi_source_impl(const std::string& mcast_address,
+                      const std::vector<unsigned int>& ssrcs,
+                      int num_outputs=1,
+                      int in_channels=1,
+                      bool quiet=false,
+                      int batch_size=16);
+    ~multi_source_impl();
+
+    int get_channels() const override { return channels; };
+
+    std::vector<unsigned int> get_ssrcs() const override {
+        gr::thread::scoped_lock lock(ssrcs_mutex);
+        return ssrcs;
+    };
+
+    int general_work(int noutput_items,
+                     gr_vector_int& ninput_items,
+                     gr_vector_const_void_star& input_items,
+                     gr_vector_void_star& output_items) override;
+
+private:
+    int find_output(uint32_t ssrc);
+};
+
+} // namespace rtp
+} // namespace gr
+
+#endif /* INCLUDED_RTP_MULTI_SOURCE_IMPL_H */
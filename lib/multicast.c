@@ -175,7 +175,13 @@ int listen_mcast(void const *s,char const *iface){
 // Resolve a multicast target string in the form "name[:port][,iface]"
 // If "name" is not qualified (no periods) then .local will be appended by default
 // If :port is not specified, port field in result will be zero
+// Retries every 10 sec until it succeeds
 int resolve_mcast(char const *target,void *sock,int default_port,char *iface,int iface_len){
+  return resolve_mcast_tries(target,sock,default_port,iface,iface_len,0);
+}
+
+// Same, but gives up with -1 after 'tries' failed lookups (0 = never give up)
+int resolve_mcast_tries(char const *target,void *sock,int default_port,char *iface,int iface_len,int tries){
   if(target == NULL || strlen(target) == 0 || sock == NULL)
     return -1;
 
@@ -231,11 +237,13 @@ int resolve_mcast(char const *target,void *sock,int default_port,char *iface,int
     int const ecode = getaddrinfo(full_host,port,&hints,&results);
     if(ecode == 0)
       break;
+    if(tries > 0 && try + 1 >= tries)
+      return -1; // Caller reports and retries as it sees fit
     if(try == 0) // Don't pollute the syslog
       fprintf(stderr,"resolve_mcast getaddrinfo(host=%s, port=%s): %s. Retrying.\n",full_host,port,gai_strerror(ecode));
     sleep(10);
   }
-  if(try > 0) // Don't leave them hanging: report success after failure
+  if(try > 0 && tries != 1) // Don't leave them hanging: report success after failure
     fprintf(stderr,"resolve_mcast getaddrinfo(%s,%s) succeeded\n",full_host,port);
 
   // Use first entry on list -- much simpler
@@ -363,16 +371,52 @@ char *formataddr(char *result,int size,void const *s){
 
 // Convert binary sockaddr structure to printable host:port string
 // cache result, as getnameinfo can be very slow when it doesn't get a reverse DNS hit
-// Needs locks to be made thread safe
+// Never blocks: a new address is formatted numerically right away and, if Resolve_names
+// is set, its name is looked up by a background thread that swaps it in when done.
+// Thread safe; entries are never freed, so the returned strings stay valid
 
 struct inverse_cache {
   struct inverse_cache *next;
   struct inverse_cache *prev;
+  struct inverse_cache *pending; // resolver queue
   struct sockaddr_storage sock;
-  char hostport [NI_MAXHOST+NI_MAXSERV+5];
+  int slen;
+  char const *hostport; // numeric, then name once resolved (atomic)
+  char numeric [NI_MAXHOST+NI_MAXSERV+5];
+  char name [NI_MAXHOST+NI_MAXSERV+5];
 };
 
+bool Resolve_names = true;
+
 static struct inverse_cache *Inverse_cache_table; // Head of cache linked list
+static pthread_mutex_t Inverse_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct inverse_cache *Resolver_queue; // Entries waiting for a name
+static pthread_cond_t Resolver_cond = PTHREAD_COND_INITIALIZER;
+static bool Resolver_running;
+
+// Background reverse DNS for formatsock()
+static void *resolver(void *arg){
+  (void)arg;
+  pthread_setname("formatsock");
+  while(true){
+    pthread_mutex_lock(&Inverse_cache_mutex);
+    while(Resolver_queue == NULL)
+      pthread_cond_wait(&Resolver_cond,&Inverse_cache_mutex);
+    struct inverse_cache * const ic = Resolver_queue;
+    Resolver_queue = ic->pending;
+    pthread_mutex_unlock(&Inverse_cache_mutex);
+
+    char host[NI_MAXHOST],port[NI_MAXSERV];
+    if(getnameinfo((struct sockaddr *)&ic->sock,ic->slen,
+		   host,NI_MAXHOST,
+		   port,NI_MAXSERV,
+		   NI_NOFQDN|NI_NUMERICSERV) == 0){
+      snprintf(ic->name,sizeof(ic->name),"%s:%s",host,port);
+      __atomic_store_n(&ic->hostport,ic->name,__ATOMIC_RELEASE);
+    }
+  }
+  return NULL;
+}
 
 // We actually take a sockaddr *, but can also accept a sockaddr_in *, sockaddr_in6 * and sockaddr_storage *
 // so to make it easier for callers we just take a void * and avoid pointer casts that impair readability
@@ -393,21 +437,22 @@ char const *formatsock(void const *s){
     return NULL;
   }
 
+  pthread_mutex_lock(&Inverse_cache_mutex);
   for(struct inverse_cache *ic = Inverse_cache_table; ic != NULL; ic = ic->next){
     if(address_match(&ic->sock,sa) && getportnumber(&ic->sock) == getportnumber(sa)){
-      if(ic->prev == NULL)
-	return ic->hostport; // Already at top of list
-
-      // move to top of list so it'll be faster to find if we look for it again soon
-      ic->prev->next = ic->next;
-      if(ic->next)
-	ic->next->prev = ic->prev;
-      
-      ic->next = Inverse_cache_table;
-      ic->next->prev = ic;
-      ic->prev = NULL;
-      Inverse_cache_table = ic;
-      return ic->hostport;
+      if(ic->prev != NULL){
+	// move to top of list so it'll be faster to find if we look for it again soon
+	ic->prev->next = ic->next;
+	if(ic->next)
+	  ic->next->prev = ic->prev;
+
+	ic->next = Inverse_cache_table;
+	ic->next->prev = ic;
+	ic->prev = NULL;
+	Inverse_cache_table = ic;
+      }
+      pthread_mutex_unlock(&Inverse_cache_mutex);
+      return __atomic_load_n(&ic->hostport,__ATOMIC_ACQUIRE);
     }
   }
   // Not in list yet, add at top
@@ -415,21 +460,38 @@ char const *formatsock(void const *s){
   assert(ic != NULL); // Malloc failures are rare
   char host[NI_MAXHOST],port[NI_MAXSERV];
   memset(host,0,sizeof(host));
-  memset(port,0,sizeof(port));  
+  memset(port,0,sizeof(port));
   getnameinfo(sa,slen,
 	      host,NI_MAXHOST,
 	      port,NI_MAXSERV,
-	      //		NI_NOFQDN|NI_NUMERICHOST|NI_NUMERICSERV);
-	      NI_NOFQDN|NI_NUMERICSERV);
-  snprintf(ic->hostport,sizeof(ic->hostport),"%s:%s",host,port);
-  assert(slen < sizeof(ic->sock));
+	      NI_NUMERICHOST|NI_NUMERICSERV);
+  snprintf(ic->numeric,sizeof(ic->numeric),"%s:%s",host,port);
+  ic->hostport = ic->numeric;
+  assert(slen <= (int)sizeof(ic->sock));
   memcpy(&ic->sock,sa,slen);
+  ic->slen = slen;
   // Put at head of table
   ic->next = Inverse_cache_table;
   if(ic->next)
     ic->next->prev = ic;
   Inverse_cache_table = ic;
-  return ic->hostport;
+
+  if(Resolve_names){
+    // Queue it for the resolver thread, starting it if needed
+    ic->pending = Resolver_queue;
+    Resolver_queue = ic;
+    if(!Resolver_running){
+      pthread_t thread;
+      pthread_attr_t attr;
+      pthread_attr_init(&attr);
+      pthread_attr_setdetachstate(&attr,PTHREAD_CREATE_DETACHED);
+      Resolver_running = (pthread_create(&thread,&attr,resolver,NULL) == 0);
+      pthread_attr_destroy(&attr);
+    }
+    pthread_cond_signal(&Resolver_cond);
+  }
+  pthread_mutex_unlock(&Inverse_cache_mutex);
+  return __atomic_load_n(&ic->hostport,__ATOMIC_ACQUIRE); // the resolver may have stored the name already
 }
 
 char const *id_from_type(int const type){
@@ -129,6 +129,7 @@ struct rtcp_sdes {
 };
 
 char const *formatsock(void const *);
+extern bool Resolve_names; // formatsock() looks up host names in the background
 char *formataddr(char *result,int size,void const *s);
 
 #define PKTSIZE 65536 // Largest possible IP datagram, in case we use jumbograms
@@ -157,6 +158,7 @@ static inline int setup_mcast_in(char const *target,struct sockaddr *sock,int of
 int connect_mcast(void const *sock,char const *iface,int const ttl,int const tos);
 int listen_mcast(void const *sock,char const *iface);
 int resolve_mcast(char const *target,void *sock,int default_port,char *iface,int iface_len);
+int resolve_mcast_tries(char const *target,void *sock,int default_port,char *iface,int iface_len,int tries);
 int setportnumber(void *sock,uint16_t port);
 int getportnumber(void const *sock);
 int address_match(void const *arg1,void const *arg2);
@@ -0,0 +1,121 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 Franco Venturi.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_RTP_PACKET_ARENA_H
+#define INCLUDED_RTP_PACKET_ARENA_H
+
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+
+namespace gr {
+namespace rtp {
+
+// Largest datagram we keep (allow for jumbograms)
+static int const Packet_slot_size = 9000;
+
+// Fixed pool of packet buffers, in a single allocation made up front
+// Every buffer starts on a cache line. Sized from the interface MTU with
+// slot_size_for() rather than for jumbograms, the rings and jitter buffers
+// built on it are several times smaller, and their working set stays in L1/L2.
+class packet_arena
+{
+public:
+    static int const Alignment = 64; // cache line
+
+    packet_arena(int count, int slot_size)
+        : d_count(std::max(count, 0)),
+          d_slot_size((std::max(slot_size, 1) + Alignment - 1) / Alignment * Alignment),
+          d_memory(static_cast<uint8_t *>(
+              aligned_alloc(Alignment, std::max(size_t(d_count) * d_slot_size, size_t(Alignment)))))
+    {
+        if (!d_memory) {
+            throw std::bad_alloc();
+        }
+    }
+
+    int count() const { return d_count; }
+    int slot_size() const { return d_slot_size; }
+    uint8_t *slot(int i) const { return d_memory.get() + size_t(i) * d_slot_size; }
+
+    // Buffer size for the datagrams received on iface: the largest UDP payload
+    // that fits its MTU, up to Packet_slot_size
+    // Datagrams bigger than that would have to be IP fragments; receivers
+    // drop (and count) them rather than decode them truncated.
+    // With no interface (NULL or empty), any of them could deliver it, loopback
+    // included, whose MTU is no limit: Packet_slot_size
+    static int slot_size_for(char const *iface)
+    {
+        if (iface == NULL || iface[0] == '\0') {
+            return Packet_slot_size;
+        }
+        return payload_size_for(iface);
+    }
+
+    // Largest UDP payload sent on iface in one piece (NULL or empty = the
+    // largest of the interfaces up, but loopback), up to Packet_slot_size
+    // Returns Packet_slot_size if the MTU is unknown
+    static int payload_size_for(char const *iface)
+    {
+        int const fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd == -1) {
+            return Packet_slot_size;
+        }
+        int mtu = 0;
+        if (iface != NULL && iface[0] != '\0') {
+            mtu = interface_mtu(fd, iface);
+        } else {
+            // Any interface could deliver it: size for the largest one
+            struct ifaddrs *ifaddrs;
+            if (getifaddrs(&ifaddrs) == 0) {
+                for (struct ifaddrs *ifa = ifaddrs; ifa != NULL; ifa = ifa->ifa_next) {
+                    if ((ifa->ifa_flags & IFF_UP) && !(ifa->ifa_flags & IFF_LOOPBACK)) {
+                        mtu = std::max(mtu, interface_mtu(fd, ifa->ifa_name));
+                    }
+                }
+                freeifaddrs(ifaddrs);
+            }
+        }
+        close(fd);
+        if (mtu <= Udp_overhead) {
+            return Packet_slot_size;
+        }
+        return std::min(mtu - Udp_overhead, Packet_slot_size);
+    }
+
+private:
+    static int const Udp_overhead = 28; // IPv4 + UDP headers (IPv6 has 20 more)
+
+    static int interface_mtu(int fd, char const *iface)
+    {
+        struct ifreq ifr;
+        memset(&ifr, 0, sizeof(ifr));
+        strncpy(ifr.ifr_name, iface, IFNAMSIZ - 1);
+        return ioctl(fd, SIOCGIFMTU, &ifr) == 0 ? ifr.ifr_mtu : 0;
+    }
+
+    struct free_deleter {
+        void operator()(uint8_t *p) const { free(p); }
+    };
+
+    int const d_count;
+    int const d_slot_size;
+    std::unique_ptr<uint8_t, free_deleter> const d_memory;
+};
+
+} // namespace rtp
+} // namespace gr
+
+#endif /* INCLUDED_RTP_PACKET_ARENA_H */
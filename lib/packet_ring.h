@@ -0,0 +1,176 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 Franco Venturi.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_RTP_PACKET_RING_H
+#define INCLUDED_RTP_PACKET_RING_H
+
+#include <gnuradio/thread/thread.h>
+
+#include <sys/socket.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "packet_arena.h"
+
+namespace gr {
+namespace rtp {
+
+// One received datagram
+struct packet_slot {
+    int len;                         // datagram length
+    struct sockaddr_storage sender;  // datagram source address
+    int64_t kernel_ns;               // kernel receive time (0 = unknown)
+    int64_t recv_ns;                 // time it was read from the socket (same)
+    uint8_t *data;                   // slot_size() bytes in the ring's arena
+};
+
+// Lock-free single-producer/single-consumer ring of preallocated packet slots
+// The producer (receiver thread) fills free slots in place, then publishes them;
+// the consumer (work()) reads and releases them in order.
+// Only a consumer that finds the ring empty takes the mutex to sleep.
+class packet_ring
+{
+public:
+    // slot_size = largest datagram it holds (see packet_arena::slot_size_for())
+    explicit packet_ring(int depth, int slot_size = Packet_slot_size)
+        : d_size(round_up_pow2(depth)),
+          d_mask(d_size - 1),
+          d_slots(new packet_slot[d_size]()),
+          d_arena(d_size, slot_size),
+          d_head(0),
+          d_tail(0),
+          d_waiting(false),
+          d_overruns(0),
+          d_truncations(0),
+          d_high_water(0)
+    {
+        for (int i = 0; i < d_size; i++) {
+            d_slots[i].data = d_arena.slot(i);
+        }
+    }
+
+    int depth() const { return d_size; }
+    int slot_size() const { return d_arena.slot_size(); }
+    uint64_t overruns() const { return d_overruns.load(std::memory_order_relaxed); }
+    uint64_t truncations() const { return d_truncations.load(std::memory_order_relaxed); }
+    int high_water() const { return d_high_water.load(std::memory_order_relaxed); }
+
+    // Producer side
+
+    // Number of free slots
+    int writable() const
+    {
+        return d_size - (d_head.load(std::memory_order_relaxed) -
+                         d_tail.load(std::memory_order_acquire));
+    }
+
+    // i-th free slot after the last published one (i < writable())
+    packet_slot* write_slot(int i)
+    {
+        return &d_slots[(d_head.load(std::memory_order_relaxed) + i) & d_mask];
+    }
+
+    // Make the next n filled slots visible to the consumer
+    void publish(int n)
+    {
+        size_t const head = d_head.load(std::memory_order_relaxed) + n;
+        d_head.store(head, std::memory_order_seq_cst);
+        int const fill = head - d_tail.load(std::memory_order_relaxed);
+        if (fill > d_high_water.load(std::memory_order_relaxed)) {
+            d_high_water.store(fill, std::memory_order_relaxed);
+        }
+        if (d_waiting.load(std::memory_order_seq_cst)) {
+            gr::thread::scoped_lock lock(d_mutex);
+            d_cond.notify_one();
+        }
+    }
+
+    // A datagram was discarded because the ring was full
+    void overrun() { d_overruns.fetch_add(1, std::memory_order_relaxed); }
+
+    // A datagram was discarded because it was bigger than a slot
+    void truncation() { d_truncations.fetch_add(1, std::memory_order_relaxed); }
+
+    // Consumer side
+
+    // Oldest published slot, or NULL if the ring is empty
+    packet_slot* read_slot()
+    {
+        size_t const tail = d_tail.load(std::memory_order_relaxed);
+        if (tail == d_head.load(std::memory_order_acquire)) {
+            return NULL;
+        }
+        return &d_slots[tail & d_mask];
+    }
+
+    // Give the oldest slot back to the producer
+    void release()
+    {
+        d_tail.store(d_tail.load(std::memory_order_relaxed) + 1,
+                     std::memory_order_release);
+    }
+
+    // Block until there is something to read, or for at most timeout_ms if >= 0
+    // This is a Boost interruption point, so the scheduler can still stop us
+    // Returns false on timeout
+    bool wait(int timeout_ms = -1)
+    {
+        auto const deadline = boost::chrono::steady_clock::now() +
+                              boost::chrono::milliseconds(timeout_ms);
+        gr::thread::scoped_lock lock(d_mutex);
+        d_waiting.store(true, std::memory_order_seq_cst);
+        bool ready = true;
+        while (d_tail.load(std::memory_order_relaxed) ==
+               d_head.load(std::memory_order_seq_cst)) {
+            try {
+                if (timeout_ms < 0) {
+                    d_cond.wait(lock);
+                } else if (d_cond.wait_until(lock, deadline) == boost::cv_status::timeout) {
+                    ready = d_tail.load(std::memory_order_relaxed) !=
+                            d_head.load(std::memory_order_seq_cst);
+                    break;
+                }
+            } catch (...) {
+                d_waiting.store(false, std::memory_order_relaxed);
+                throw;
+            }
+        }
+        d_waiting.store(false, std::memory_order_relaxed);
+        return ready;
+    }
+
+private:
+    static int round_up_pow2(int n)
+    {
+        int size = 1;
+        while (size < n) {
+            size <<= 1;
+        }
+        return size;
+    }
+
+    int const d_size;
+    size_t const d_mask;
+    std::unique_ptr<packet_slot[]> d_slots;
+    packet_arena d_arena; // the slots' data
+
+    alignas(64) std::atomic<size_t> d_head; // written by the producer only
+    alignas(64) std::atomic<size_t> d_tail; // written by the consumer only
+    alignas(64) std::atomic<bool> d_waiting;
+    std::atomic<uint64_t> d_overruns;
+    std::atomic<uint64_t> d_truncations;
+    std::atomic<int> d_high_water;
+
+    gr::thread::mutex d_mutex;
+    gr::thread::condition_variable d_cond;
+};
+
+} // namespace rtp
+} // namespace gr
+
+#endif /* INCLUDED_RTP_PACKET_RING_H */
@@ -0,0 +1,163 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 Franco Venturi.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "convert.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace gr::rtp;
+
+// Every vectorized kernel must give exactly the output of the scalar code,
+// whatever the alignment of its pointers and the length of its tail
+
+static int const Max_length = 300; // covers every vector width and tail
+static int const Guard = 16;       // items past the end that must stay untouched
+
+static std::vector<uint8_t> random_payload(size_t size)
+{
+    std::mt19937 random(20230601);
+    std::vector<uint8_t> payload(size);
+    for (auto& b : payload) {
+        b = random();
+    }
+    return payload;
+}
+
+// Compare the whole output, guard included, bit for bit
+template <typename T>
+static void check_same(std::vector<T> const& got,
+                       std::vector<T> const& want,
+                       int n,
+                       char const *what,
+                       int in_offset,
+                       int out_offset)
+{
+    BOOST_TEST_INFO(what << " n=" << n << " input offset=" << in_offset
+                         << " output offset=" << out_offset);
+    BOOST_CHECK(memcmp(got.data(), want.data(), got.size() * sizeof(T)) == 0);
+}
+
+// Run kernel and reference on the same input for every length and alignment
+// run(kernel, in, outs..., n) picks the variant: true = kernel, false = reference
+template <typename T, typename Run>
+static void check_kernel(char const *what, int bytes_per_item, int outputs, Run run)
+{
+    auto const payload = random_payload(8 * Max_length + 64);
+    for (int in_offset = 0; in_offset < 4; in_offset++) {
+        for (int out_offset = 0; out_offset < 2; out_offset++) {
+            for (int n = 0; n <= Max_length; n++) {
+                std::vector<uint8_t> in(payload.begin() + in_offset,
+                                        payload.begin() + in_offset + bytes_per_item * n + 16);
+                std::vector<std::vector<T>> got, want;
+                for (int i = 0; i < outputs; i++) {
+                    size_t const size = out_offset + 2 * n + Guard;
+                    got.emplace_back(size, T(-7));
+                    want.emplace_back(size, T(-7));
+                }
+                run(true, in.data(), got, out_offset, n);
+                run(false, in.data(), want, out_offset, n);
+                for (int i = 0; i < outputs; i++) {
+                    check_same(got[i], want[i], n, what, in_offset, out_offset);
+                }
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(t_s16be_f32)
+{
+    check_kernel<float>("s16be_f32", 2, 1, [](bool k, uint8_t const *in, auto& o, int off, int n) {
+        (k ? convert_s16be_f32 : convert_generic::s16be_f32)(in, o[0].data() + off, n);
+    });
+}
+
+BOOST_AUTO_TEST_CASE(t_s16be_cf32_real)
+{
+    check_kernel<float>(
+        "s16be_cf32_real", 2, 1, [](bool k, uint8_t const *in, auto& o, int off, int n) {
+            (k ? convert_s16be_cf32_real : convert_generic::s16be_cf32_real)(
+                in, o[0].data() + off, n);
+        });
+}
+
+BOOST_AUTO_TEST_CASE(t_s16be_f32_deinterleave)
+{
+    check_kernel<float>(
+        "s16be_f32_deinterleave", 4, 2, [](bool k, uint8_t const *in, auto& o, int off, int n) {
+            (k ? convert_s16be_f32_deinterleave : convert_generic::s16be_f32_deinterleave)(
+                in, o[0].data() + off, o[1].data() + off, n);
+        });
+}
+
+BOOST_AUTO_TEST_CASE(t_s16be_f32_downmix)
+{
+    check_kernel<float>(
+        "s16be_f32_downmix", 4, 1, [](bool k, uint8_t const *in, auto& o, int off, int n) {
+            (k ? convert_s16be_f32_downmix : convert_generic::s16be_f32_downmix)(
+                in, o[0].data() + off, n);
+        });
+}
+
+BOOST_AUTO_TEST_CASE(t_s16be_f32_dup)
+{
+    check_kernel<float>(
+        "s16be_f32_dup", 2, 2, [](bool k, uint8_t const *in, auto& o, int off, int n) {
+            (k ? convert_s16be_f32_dup : convert_generic::s16be_f32_dup)(
+                in, o[0].data() + off, o[1].data() + off, n);
+        });
+}
+
+BOOST_AUTO_TEST_CASE(t_s16be_s16)
+{
+    check_kernel<int16_t>("s16be_s16", 2, 1, [](bool k, uint8_t const *in, auto& o, int off, int n) {
+        (k ? convert_s16be_s16 : convert_generic::s16be_s16)(in, o[0].data() + off, n);
+    });
+}
+
+BOOST_AUTO_TEST_CASE(t_s16be_s16_deinterleave)
+{
+    check_kernel<int16_t>(
+        "s16be_s16_deinterleave", 4, 2, [](bool k, uint8_t const *in, auto& o, int off, int n) {
+            (k ? convert_s16be_s16_deinterleave : convert_generic::s16be_s16_deinterleave)(
+                in, o[0].data() + off, o[1].data() + off, n);
+        });
+}
+
+BOOST_AUTO_TEST_CASE(t_s16be_s16_dup)
+{
+    check_kernel<int16_t>(
+        "s16be_s16_dup", 2, 2, [](bool k, uint8_t const *in, auto& o, int off, int n) {
+            (k ? convert_s16be_s16_dup : convert_generic::s16be_s16_dup)(
+                in, o[0].data() + off, o[1].data() + off, n);
+        });
+}
+
+// The decoders, for every payload encoding (4 bytes per sample covers them all)
+static encoding const Encodings[] = { encoding::S16BE, encoding::S16LE,    encoding::S8,
+                                      encoding::S12BE, encoding::AIRSPY12, encoding::F32LE };
+
+BOOST_AUTO_TEST_CASE(t_decode_f32)
+{
+    for (auto enc : Encodings) {
+        check_kernel<float>("decode_f32", 4, 1, [enc](bool k, uint8_t const *in, auto& o, int off, int n) {
+            (k ? decode_f32 : convert_generic::decode_f32)(enc, in, o[0].data() + off, n);
+        });
+    }
+}
+
+BOOST_AUTO_TEST_CASE(t_decode_s16)
+{
+    for (auto enc : Encodings) {
+        check_kernel<int16_t>("decode_s16", 4, 1, [enc](bool k, uint8_t const *in, auto& o, int off, int n) {
+            (k ? decode_s16 : convert_generic::decode_s16)(enc, in, o[0].data() + off, n);
+        });
+    }
+}
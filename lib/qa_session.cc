@@ -0,0 +1,351 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 Franco Venturi.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "session.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <boost/test/unit_test.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+using namespace gr::rtp;
+
+// Packets of Frames mono 16-bit frames (20 ms at 12 kHz), every sample
+// holding the packet number + 1, so the output tells which packet it came from
+static int const Frames = 240;
+static uint32_t const Ssrc = 7;
+static int const Output_size = 100000;
+
+namespace {
+
+class stream
+{
+public:
+    // jitter_packets = 0: no reordering
+    explicit stream(int jitter_packets = 0)
+        : s(1, true, std::make_shared<gr::logger>("qa_session"), jitter_packets, 0),
+          capacity(Output_size),
+          out(Output_size),
+          produced(0)
+    {
+        memset(&sender, 0, sizeof(sender));
+        sender.sin_family = AF_INET;
+        sender.sin_port = htons(5004);
+        sender.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    }
+
+    // Send packet p with sequence number seq and timestamp ts, that arrived
+    // at arrival_ns (0 = now); size = payload bytes
+    bool send(int p,
+              uint16_t seq,
+              uint32_t ts,
+              bool marker = false,
+              int size = 2 * Frames,
+              int64_t arrival_ns = 0)
+    {
+        std::vector<uint8_t> payload(size);
+        for (int i = 0; i + 1 < size; i += 2) {
+            payload[i] = (p + 1) >> 8;
+            payload[i + 1] = (p + 1) & 0xff;
+        }
+        rtp_info rtp{ Ssrc, ts, seq, PCM_MONO_12_PT, marker };
+        float *outs[1] = { out.data() };
+        return s.process(&rtp, payload.data(), size,
+                         reinterpret_cast<struct sockaddr const *>(&sender), outs,
+                         capacity, 1, produced, arrival_ns);
+    }
+    // Send packet p in sequence (seq p, timestamp p * Frames)
+    bool send(int p, int64_t arrival_ns = 0)
+    {
+        return send(p, p, p * Frames, false, 2 * Frames, arrival_ns);
+    }
+
+    // The output so far, one entry per packet: its number, or -1 for zeroes
+    std::vector<int> packets()
+    {
+        float *outs[1] = { out.data() };
+        s.drain(outs, capacity, 1, produced);
+        std::vector<int> result;
+        for (int i = 0; i < produced; i += Frames) {
+            result.push_back(int(std::lround(out[i] * 32767.0f)) - 1);
+        }
+        return result;
+    }
+
+    stream_stats const& stats() const { return s.get_stats(); }
+
+    int output_items() const { return produced; }
+
+    session<float> s;
+    int capacity; // output items process() may fill
+
+private:
+    struct sockaddr_in sender;
+    std::vector<float> out;
+    int produced;
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(t_jitter_buffer_reorder)
+{
+    stream st(4);
+    for (int p : { 0, 1, 2, 4, 3, 5, 5, 8, 9, 10, 11 }) {
+        BOOST_CHECK(st.send(p));
+    }
+    // 6 and 7 are given up on when 11 doesn't fit: their frames are zero-filled;
+    // the second 5 comes after the first one was played, so it counts as late
+    std::vector<int> const want = { 0, 1, 2, 3, 4, 5, -1, -1, 8, 9, 10, 11 };
+    auto const got = st.packets();
+    BOOST_CHECK_EQUAL_COLLECTIONS(got.begin(), got.end(), want.begin(), want.end());
+    BOOST_CHECK_EQUAL(stream_stats::get(st.stats().reordered), 1u);
+    BOOST_CHECK_EQUAL(stream_stats::get(st.stats().lost), 2u);
+    BOOST_CHECK_EQUAL(stream_stats::get(st.stats().late), 1u);
+    BOOST_CHECK_EQUAL(st.stats().reorder_depth.load(), 1);
+
+    // too late for its turn
+    BOOST_CHECK(st.send(7));
+    BOOST_CHECK_EQUAL(stream_stats::get(st.stats().late), 2u);
+    BOOST_CHECK_EQUAL(st.packets().size(), want.size());
+}
+
+// A restarted sender (same address and port) jumps to any sequence number
+// and timestamp: that's a new stream, not late or far ahead packets
+BOOST_AUTO_TEST_CASE(t_jitter_buffer_restart)
+{
+    stream st(4);
+    for (int p = 0; p < 3; p++) {
+        BOOST_CHECK(st.send(p, 20000 + p, 1000 + p * Frames));
+    }
+    // far ahead, no marker
+    for (int p = 3; p < 6; p++) {
+        BOOST_CHECK(st.send(p, 30000 + p, 500000 + p * Frames));
+    }
+    // back, with the marker on the first packet
+    for (int p = 6; p < 9; p++) {
+        BOOST_CHECK(st.send(p, 100 + p, 7777 + p * Frames, p == 6));
+    }
+    std::vector<int> const want = { 0, 1, 2, 3, 4, 5, 6, 7, 8 };
+    auto const got = st.packets();
+    BOOST_CHECK_EQUAL_COLLECTIONS(got.begin(), got.end(), want.begin(), want.end());
+    BOOST_CHECK_EQUAL(stream_stats::get(st.stats().late), 0u);
+    BOOST_CHECK_EQUAL(stream_stats::get(st.stats().lost), 0u);
+    BOOST_CHECK_EQUAL(stream_stats::get(st.stats().zero_filled), 0u);
+}
+
+// A packet too big for the jitter buffer slots is dropped, not played truncated
+BOOST_AUTO_TEST_CASE(t_jitter_buffer_oversize)
+{
+    stream st(4);
+    st.s.set_packet_size(2 * Frames);
+    BOOST_CHECK(st.send(0));
+    BOOST_CHECK(st.send(2, 2, 2 * Frames, false, 4 * Frames)); // has to be held: too big
+    BOOST_CHECK(st.send(1));
+    std::vector<int> const want = { 0, 1 };
+    auto const got = st.packets();
+    BOOST_CHECK_EQUAL_COLLECTIONS(got.begin(), got.end(), want.begin(), want.end());
+}
+
+// The telemetry of a stream with a reordered packet, a duplicate and a gap,
+// arriving every 20 ms with 2 ms of jitter
+static void send_unsteady(stream& st)
+{
+    int64_t const t0 = 1700000000000000000LL;
+    int k = 0;
+    for (int p : { 0, 1, 2, 4, 3, 5, 5, 8, 9 }) {
+        BOOST_CHECK(st.send(p, t0 + k * 20000000LL + (k % 2 ? 2000000 : 0)));
+        k++;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(t_stats_direct)
+{
+    stream st;
+    send_unsteady(st);
+    // 3 comes after its place was zero-filled and the second 5 is a duplicate:
+    // both are dropped as old (dupes); 3, 6 and 7 count as missing (drops)
+    std::vector<int> const want = { 0, 1, 2, -1, 4, 5, -1, -1, 8, 9 };
+    auto const got = st.packets();
+    BOOST_CHECK_EQUAL_COLLECTIONS(got.begin(), got.end(), want.begin(), want.end());
+    stream_stats const& stats = st.stats();
+    BOOST_CHECK_EQUAL(stream_stats::get(stats.packets), 9u);
+    BOOST_CHECK_EQUAL(stream_stats::get(stats.drops), 3u);
+    BOOST_CHECK_EQUAL(stream_stats::get(stats.dupes), 2u);
+    BOOST_CHECK_EQUAL(stream_stats::get(stats.zero_filled), 3u * Frames);
+    BOOST_CHECK_EQUAL(stats.reorder_depth.load(), 1);
+    BOOST_CHECK_GT(stats.jitter.ms(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(t_stats_jitter_buffer)
+{
+    stream st(4);
+    send_unsteady(st);
+    // 3 is put back in its place; 8 and 9 wait for 6 and 7
+    std::vector<int> const want = { 0, 1, 2, 3, 4, 5 };
+    auto const got = st.packets();
+    BOOST_CHECK_EQUAL_COLLECTIONS(got.begin(), got.end(), want.begin(), want.end());
+    stream_stats const& stats = st.stats();
+    BOOST_CHECK_EQUAL(stream_stats::get(stats.packets), 9u);
+    BOOST_CHECK_EQUAL(stream_stats::get(stats.reordered), 1u);
+    BOOST_CHECK_EQUAL(stream_stats::get(stats.late), 1u); // the second 5
+    BOOST_CHECK_EQUAL(stream_stats::get(stats.lost), 0u);
+    BOOST_CHECK_EQUAL(stream_stats::get(stats.drops), 0u);
+    BOOST_CHECK_EQUAL(stats.reorder_depth.load(), 1);
+
+    // 10 and 11 don't fit: 6 and 7 are given up on
+    BOOST_CHECK(st.send(10, 10, 10 * Frames));
+    BOOST_CHECK(st.send(11, 11, 11 * Frames));
+    BOOST_CHECK_EQUAL(stream_stats::get(stats.lost), 2u);
+    BOOST_CHECK_EQUAL(stream_stats::get(stats.zero_filled), 2u * Frames);
+}
+
+// A packet that doesn't fit in the output is given again with the next
+// work() call: it's counted only once
+BOOST_AUTO_TEST_CASE(t_stats_retry)
+{
+    stream st;
+    send_unsteady(st);
+    uint64_t const packets = stream_stats::get(st.stats().packets);
+    st.capacity = st.output_items() + 10;
+    BOOST_CHECK(!st.send(10));
+    BOOST_CHECK_EQUAL(stream_stats::get(st.stats().packets), packets);
+    BOOST_CHECK_EQUAL(stream_stats::get(st.stats().drops), 3u);
+}
+
+// Sample values of output items (complex: I then Q)
+static void append_values(std::vector<int>& v, float x) { v.push_back(std::lround(x * 32768.0f)); }
+static void append_values(std::vector<int>& v, int16_t x) { v.push_back(x); }
+static void append_values(std::vector<int>& v, gr_complex x)
+{
+    append_values(v, x.real());
+    append_values(v, x.imag());
+}
+
+// Lost packets of the carry-over streams
+static bool carry_lost(int p) { return p == 3 || p == 7 || p == 8; }
+
+// Send Carry_packets packets of Frames frames (frame f of packet p holds
+// p * Frames + f + 1, negated on the second channel), but the lost ones,
+// through outputs of nitems items per call the way work() does: as many
+// packets as fit, then drain(). Returns the sample values of each output
+static int const Carry_packets = 20;
+
+template <typename T>
+static std::vector<std::vector<int>>
+carry_over(int channels, int noutputs, int type, int nitems, int jitter_packets)
+{
+    session<T> s(channels, true, std::make_shared<gr::logger>("qa_session"), jitter_packets, 0);
+    struct sockaddr_in sender;
+    memset(&sender, 0, sizeof(sender));
+    sender.sin_family = AF_INET;
+    sender.sin_port = htons(5004);
+    sender.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    std::deque<int> pending;
+    for (int p = 0; p < Carry_packets; p++) {
+        if (!carry_lost(p)) {
+            pending.push_back(p);
+        }
+    }
+    std::vector<std::vector<T>> buffers(noutputs, std::vector<T>(nitems));
+    std::vector<T*> outs(noutputs);
+    std::vector<std::vector<int>> values(noutputs);
+    // enough calls for one item each
+    for (int call = 0; call < Carry_packets * Frames * channels; call++) {
+        for (int i = 0; i < noutputs; i++) {
+            outs[i] = buffers[i].data();
+        }
+        int produced = 0;
+        while (!pending.empty() && produced < nitems) {
+            int const p = pending.front();
+            std::vector<uint8_t> payload;
+            for (int f = 0; f < Frames; f++) {
+                for (int c = 0; c < channels; c++) {
+                    int const x = c == 0 ? p * Frames + f + 1 : -(p * Frames + f + 1);
+                    payload.push_back(x >> 8);
+                    payload.push_back(x & 0xff);
+                }
+            }
+            rtp_info rtp{ Ssrc, uint32_t(p * Frames), uint16_t(p), uint8_t(type), false };
+            if (!s.process(&rtp, payload.data(), payload.size(),
+                           reinterpret_cast<struct sockaddr const *>(&sender), outs.data(),
+                           nitems, noutputs, produced)) {
+                break;
+            }
+            pending.pop_front();
+        }
+        s.drain(outs.data(), nitems, noutputs, produced);
+        if (pending.empty() && produced == 0) {
+            break;
+        }
+        for (int i = 0; i < noutputs; i++) {
+            for (int j = 0; j < produced; j++) {
+                append_values(values[i], buffers[i][j]);
+            }
+        }
+    }
+    return values;
+}
+
+// What carry_over() must return: every sample in order, zeroes for the lost
+// packets; two channels on a single output are interleaved
+static std::vector<std::vector<int>> carry_over_want(int channels, int noutputs)
+{
+    std::vector<std::vector<int>> want(noutputs);
+    for (int p = 0; p < Carry_packets; p++) {
+        for (int f = 0; f < Frames; f++) {
+            int const v = carry_lost(p) ? 0 : p * Frames + f + 1;
+            if (channels == 2 && noutputs == 1) {
+                want[0].push_back(v);
+                want[0].push_back(-v);
+            } else {
+                for (int i = 0; i < noutputs; i++) {
+                    want[i].push_back(i == 0 ? v : -v);
+                }
+            }
+        }
+    }
+    return want;
+}
+
+// Packets bigger than the output buffer (and not a multiple of it) are
+// carried over to the next calls, without losing or repeating samples
+BOOST_AUTO_TEST_CASE(t_carry_over)
+{
+    for (int jitter_packets : { 0, 8 }) {
+        for (int nitems : { 100, 239, 1000 }) {
+            BOOST_TEST_CONTEXT("nitems " << nitems << ", jitter_packets " << jitter_packets)
+            {
+                BOOST_CHECK(carry_over<float>(1, 1, PCM_MONO_12_PT, nitems, jitter_packets) ==
+                            carry_over_want(1, 1));
+                BOOST_CHECK(carry_over<float>(2, 2, PCM_STEREO_12_PT, nitems, jitter_packets) ==
+                            carry_over_want(2, 2));
+                BOOST_CHECK(carry_over<int16_t>(1, 1, PCM_MONO_12_PT, nitems, jitter_packets) ==
+                            carry_over_want(1, 1));
+                BOOST_CHECK(carry_over<int16_t>(2, 1, PCM_STEREO_12_PT, nitems,
+                                                jitter_packets) == carry_over_want(2, 1));
+                BOOST_CHECK(carry_over<gr_complex>(2, 1, PCM_STEREO_12_PT, nitems,
+                                                   jitter_packets) == carry_over_want(2, 1));
+            }
+        }
+    }
+}
+
+// radiod's encoding numbers (rtp.h in ka9q-radio): what a dynamic payload
+// type is decoded as
+BOOST_AUTO_TEST_CASE(t_status_format)
+{
+    BOOST_CHECK(status_format(1).enc == encoding::S16LE);
+    BOOST_CHECK(status_format(2).enc == encoding::S16BE);
+    BOOST_CHECK(status_format(4).enc == encoding::F32LE);
+    BOOST_CHECK_EQUAL(status_format(4).bits, 32);
+    BOOST_CHECK(status_format(3).enc == encoding::NONE); // Opus
+}
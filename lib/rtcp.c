@@ -0,0 +1,111 @@
+// RTCP packet generation (RFC 3550), for the functions declared in multicast.h
+// Copyright 2023 Franco Venturi
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// Each function writes one segment of a compound RTCP packet at output and
+// returns a pointer just past it, or NULL if it doesn't fit in bufsize bytes
+
+#include <string.h>
+
+#include "multicast.h"
+
+#define RTCP_SR 200
+#define RTCP_RR 201
+#define RTCP_SDES 202
+#define RTCP_BYE 203
+
+// Common header; length is in 32-bit words minus one
+static uint8_t *put_header(uint8_t *dp,int count,int type,int bytes){
+  dp = put8(dp,RTP_VERS << 6 | (count & 0x1f));
+  dp = put8(dp,type);
+  dp = put16(dp,bytes/4 - 1);
+  return dp;
+}
+
+static uint8_t *put_report_block(uint8_t *dp,struct rtcp_rr const *rr){
+  dp = put32(dp,rr->ssrc);
+  dp = put8(dp,rr->lost_fract);
+  dp = put24(dp,rr->lost_packets); // 24-bit two's complement
+  dp = put32(dp,rr->highest_seq);
+  dp = put32(dp,rr->jitter);
+  dp = put32(dp,rr->lsr);
+  dp = put32(dp,rr->dlsr);
+  return dp;
+}
+
+// Sender report, followed by rc report blocks
+uint8_t *gen_sr(uint8_t *output,int bufsize,struct rtcp_sr const *sr,struct rtcp_rr const *rr,int rc){
+  if(output == NULL || sr == NULL || rc < 0 || rc > 31 || (rc > 0 && rr == NULL))
+    return NULL;
+  int const bytes = 28 + 24 * rc;
+  if(bytes > bufsize)
+    return NULL;
+
+  uint8_t *dp = put_header(output,rc,RTCP_SR,bytes);
+  dp = put32(dp,sr->ssrc);
+  dp = put32(dp,(uint64_t)sr->ntp_timestamp >> 32);
+  dp = put32(dp,(uint32_t)sr->ntp_timestamp);
+  dp = put32(dp,sr->rtp_timestamp);
+  dp = put32(dp,sr->packet_count);
+  dp = put32(dp,sr->byte_count);
+  for(int i=0; i < rc; i++)
+    dp = put_report_block(dp,&rr[i]);
+  return dp;
+}
+
+// Receiver report from ssrc, with rc report blocks
+uint8_t *gen_rr(uint8_t *output,int bufsize,uint32_t ssrc,struct rtcp_rr const *rr,int rc){
+  if(output == NULL || rc < 0 || rc > 31 || (rc > 0 && rr == NULL))
+    return NULL;
+  int const bytes = 8 + 24 * rc;
+  if(bytes > bufsize)
+    return NULL;
+
+  uint8_t *dp = put_header(output,rc,RTCP_RR,bytes);
+  dp = put32(dp,ssrc);
+  for(int i=0; i < rc; i++)
+    dp = put_report_block(dp,&rr[i]);
+  return dp;
+}
+
+// Source description: one chunk for ssrc, with sc items
+uint8_t *gen_sdes(uint8_t *output,int bufsize,uint32_t ssrc,struct rtcp_sdes const *sdes,int sc){
+  if(output == NULL || sc < 0 || (sc > 0 && sdes == NULL))
+    return NULL;
+  int items = 0;
+  for(int i=0; i < sc; i++){
+    if(sdes[i].mlen < 0 || sdes[i].mlen > 255)
+      return NULL;
+    items += 2 + sdes[i].mlen;
+  }
+  // Item list is ended by a null byte, then padded to a 32-bit boundary
+  int const bytes = 4 + ((4 + items + 1 + 3) & ~3);
+  if(bytes > bufsize)
+    return NULL;
+
+  uint8_t *dp = put_header(output,1,RTCP_SDES,bytes);
+  dp = put32(dp,ssrc);
+  for(int i=0; i < sc; i++){
+    dp = put8(dp,sdes[i].type);
+    dp = put8(dp,sdes[i].mlen);
+    memcpy(dp,sdes[i].message,sdes[i].mlen);
+    dp += sdes[i].mlen;
+  }
+  while(dp < output + bytes)
+    *dp++ = 0;
+  return dp;
+}
+
+// Goodbye from sc sources
+uint8_t *gen_bye(uint8_t *output,int bufsize,uint32_t const *ssrcs,int sc){
+  if(output == NULL || sc < 0 || sc > 31 || (sc > 0 && ssrcs == NULL))
+    return NULL;
+  int const bytes = 4 + 4 * sc;
+  if(bytes > bufsize)
+    return NULL;
+
+  uint8_t *dp = put_header(output,sc,RTCP_BYE,bytes);
+  for(int i=0; i < sc; i++)
+    dp = put32(dp,ssrcs[i]);
+  return dp;
+}
@@ -0,0 +1,288 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 Franco Venturi.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "rtcp.h"
+
+#include <pwd.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+#include "mcast_join.h"
+#include "multicast.h"
+
+namespace gr {
+namespace rtp {
+
+// Config constants
+
+static int const Rtcp_sr = 200;       // sender report packet type
+static int const Max_dropout = 3000;  // sequence jumps taken as loss (RFC 3550 A.1)
+static int const Max_misorder = 100;  // and as late packets
+
+rtcp_receiver::rtcp_receiver(const std::string& target, const gr::logger_ptr& logger)
+    : d_target(target),
+      d_logger(logger),
+      d_own_ssrc(0),
+      d_in_fd(-1),
+      d_out_fd(-1),
+      d_ssrc(0),
+      d_base_seq(0),
+      d_max_seq(0),
+      d_received(0),
+      d_report_ssrc(0),
+      d_expected_prior(0),
+      d_received_prior(0),
+      d_sr_ssrc(0),
+      d_sr_rtp_timestamp(0),
+      d_sr_ntp(0),
+      d_sr_arrival_ns(0),
+      d_sender_reports(0),
+      d_stop(false)
+{
+    std::random_device random;
+    while (d_own_ssrc == 0) {
+        d_own_ssrc = random();
+    }
+    // Canonical name: user@host
+    char host[256];
+    if (gethostname(host, sizeof(host)) != 0) {
+        strcpy(host, "localhost");
+    }
+    host[sizeof(host) - 1] = '\0';
+    struct passwd const *pw = getpwuid(getuid());
+    d_cname = std::string(pw != NULL ? pw->pw_name : "gr-rtp") + "@" + host;
+
+    d_thread = gr::thread::thread([this] { run(); });
+}
+
+rtcp_receiver::~rtcp_receiver()
+{
+    d_stop = true;
+    d_wake.notify();
+    d_thread.join();
+    if (d_out_fd != -1) {
+        uint8_t buffer[8];
+        uint8_t const *dp = gen_bye(buffer, sizeof(buffer), &d_own_ssrc, 1);
+        send(d_out_fd, buffer, dp - buffer, MSG_DONTWAIT);
+        close(d_out_fd);
+    }
+    if (d_in_fd != -1) {
+        close(d_in_fd);
+    }
+}
+
+void rtcp_receiver::received(rtp_info const& rtp, int64_t arrival_ns)
+{
+    auto const relaxed = std::memory_order_relaxed;
+    if (rtp.ssrc != d_ssrc.load(relaxed)) {
+        // New stream: start over
+        d_base_seq.store(rtp.seq, relaxed);
+        d_max_seq.store(rtp.seq, relaxed);
+        d_received.store(0, relaxed);
+        d_jitter.reset();
+        d_ssrc.store(rtp.ssrc, std::memory_order_release);
+    } else {
+        uint32_t const max_seq = d_max_seq.load(relaxed);
+        uint16_t const udelta = rtp.seq - static_cast<uint16_t>(max_seq);
+        if (udelta < Max_dropout) {
+            d_max_seq.store(max_seq + udelta, relaxed); // in order, maybe after a gap
+        } else if (udelta <= 65536 - Max_misorder) {
+            // Too far off to be loss: the sender restarted its sequence
+            d_base_seq.store(rtp.seq, relaxed);
+            d_max_seq.store(rtp.seq, relaxed);
+            d_received.store(0, relaxed);
+        } // else late or duplicate
+    }
+    d_received.store(d_received.load(relaxed) + 1, relaxed);
+    d_jitter.update(rtp.timestamp, samprate_from_pt(rtp.type), arrival_ns);
+}
+
+bool rtcp_receiver::wall_time(uint32_t ssrc,
+                              uint32_t timestamp,
+                              int samprate,
+                              std::chrono::system_clock::time_point& t) const
+{
+    if (samprate <= 0) {
+        return false;
+    }
+    gr::thread::scoped_lock lock(d_sr_mutex);
+    if (d_sr_arrival_ns == 0 || ssrc != d_sr_ssrc) {
+        return false;
+    }
+    int32_t const frames = timestamp - d_sr_rtp_timestamp;
+    t = d_sr_time + std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                        std::chrono::duration<double>(double(frames) / samprate));
+    return true;
+}
+
+// Background thread: join the RTCP group, then read sender reports and
+// send receiver reports until destroyed
+void rtcp_receiver::run()
+{
+    std::mt19937 random(d_own_ssrc);
+    std::uniform_real_distribution<double> spread(0.5, 1.5); // RFC 3550 6.3.1
+    auto const interval = [&] {
+        return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(Report_interval * spread(random)));
+    };
+    bool warned = false;
+    auto next_report = std::chrono::steady_clock::now() + interval();
+    while (!d_stop) {
+        if (d_in_fd == -1 && !setup()) {
+            if (!warned) {
+                d_logger->warn("Can't set up RTCP for \"{}\" - retrying every {} sec",
+                               d_target, Retry_interval);
+                warned = true;
+            }
+            d_wake.wait(-1, Retry_interval * 1000);
+            continue;
+        }
+        auto const now = std::chrono::steady_clock::now();
+        if (now >= next_report) {
+            send_report();
+            next_report = now + interval();
+            continue;
+        }
+        int const timeout_ms =
+            std::chrono::duration_cast<std::chrono::milliseconds>(next_report - now).count() + 1;
+        if (d_wake.wait(d_in_fd, timeout_ms)) {
+            receive_reports();
+        }
+    }
+}
+
+// Open the RTCP sockets: same group and interface, next port
+bool rtcp_receiver::setup()
+{
+    mcast_target t;
+    if (!mcast_resolver::resolve(d_target, t)) {
+        return false;
+    }
+    setportnumber(&t.sock, getportnumber(&t.sock) + 1);
+    int const in_fd = mcast_resolver::listen(t);
+    int const out_fd = in_fd == -1 ? -1 : mcast_resolver::connect(t, Ttl);
+    if (out_fd == -1) {
+        if (in_fd != -1) {
+            close(in_fd);
+        }
+        return false;
+    }
+    d_in_fd = in_fd;
+    d_out_fd = out_fd;
+    d_logger->info("RTCP on {}", formatsock(&t.sock));
+    return true;
+}
+
+// Take the sender reports of our stream out of the compound packets received
+void rtcp_receiver::receive_reports()
+{
+    uint8_t buffer[2048];
+    for (;;) {
+        int const len = recv(d_in_fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (len <= 0) {
+            return;
+        }
+        int64_t const arrival_ns = rx_batch::now_ns();
+        uint8_t const *dp = buffer;
+        uint8_t const *const end = buffer + len;
+        while (end - dp >= 4 && (dp[0] >> 6) == RTP_VERS) {
+            int const type = dp[1];
+            int const size = (get16(dp + 2) + 1) * 4;
+            if (size > end - dp) {
+                break; // truncated
+            }
+            uint32_t const ssrc = size >= 8 ? get32(dp + 4) : 0;
+            if (type == Rtcp_sr && size >= 28 && ssrc != 0 &&
+                ssrc == d_ssrc.load(std::memory_order_acquire)) {
+                uint64_t const ntp = uint64_t(get32(dp + 8)) << 32 | get32(dp + 12);
+                // NTP seconds since 1900 and 32 bit fraction
+                auto const since_epoch =
+                    std::chrono::seconds(int64_t(ntp >> 32) - int64_t(NTP_EPOCH)) +
+                    std::chrono::duration<double>(double(ntp & 0xffffffff) / 4294967296.0);
+                bool first;
+                {
+                    gr::thread::scoped_lock lock(d_sr_mutex);
+                    first = ssrc != d_sr_ssrc;
+                    d_sr_ssrc = ssrc;
+                    d_sr_ntp = ntp;
+                    d_sr_rtp_timestamp = get32(dp + 16);
+                    d_sr_time = std::chrono::system_clock::time_point(
+                        std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                            since_epoch));
+                    d_sr_arrival_ns = arrival_ns;
+                }
+                d_sender_reports.fetch_add(1, std::memory_order_release);
+                if (first) {
+                    d_logger->info("RTCP sender reports for {}", ssrc);
+                }
+            }
+            dp += size;
+        }
+    }
+}
+
+// Receiver report on our stream (RFC 3550 6.4.2 and A.3), with our CNAME
+void rtcp_receiver::send_report()
+{
+    auto const relaxed = std::memory_order_relaxed;
+    struct rtcp_rr rr;
+    memset(&rr, 0, sizeof(rr));
+    int rc = 0;
+    uint32_t const ssrc = d_ssrc.load(std::memory_order_acquire);
+    if (ssrc != 0) {
+        uint32_t const max_seq = d_max_seq.load(relaxed);
+        uint32_t const expected = max_seq - d_base_seq.load(relaxed) + 1;
+        uint64_t const received = d_received.load(relaxed);
+        if (ssrc != d_report_ssrc || expected < d_expected_prior ||
+            received < d_received_prior) {
+            // stream restarted since the last report
+            d_report_ssrc = ssrc;
+            d_expected_prior = 0;
+            d_received_prior = 0;
+        }
+        int64_t const lost = int64_t(expected) - int64_t(received);
+        int64_t const expected_interval = expected - d_expected_prior;
+        int64_t const lost_interval = expected_interval - int64_t(received - d_received_prior);
+        d_expected_prior = expected;
+        d_received_prior = received;
+
+        rr.ssrc = ssrc;
+        rr.lost_fract = expected_interval == 0 || lost_interval <= 0
+                            ? 0
+                            : (lost_interval << 8) / expected_interval;
+        rr.lost_packets = std::min<int64_t>(std::max<int64_t>(lost, -0x800000), 0x7fffff);
+        rr.highest_seq = max_seq;
+        rr.jitter = d_jitter.units();
+        {
+            gr::thread::scoped_lock lock(d_sr_mutex);
+            if (d_sr_arrival_ns != 0 && d_sr_ssrc == ssrc) {
+                // middle 32 bits of the NTP timestamp, and the delay since in 1/65536 s
+                rr.lsr = static_cast<uint32_t>(d_sr_ntp >> 16);
+                rr.dlsr = (rx_batch::now_ns() - d_sr_arrival_ns) * 65536 / 1000000000;
+            }
+        }
+        rc = 1;
+    }
+
+    uint8_t buffer[512];
+    uint8_t *dp = gen_rr(buffer, sizeof(buffer), d_own_ssrc, &rr, rc);
+    struct rtcp_sdes sdes;
+    memset(&sdes, 0, sizeof(sdes));
+    sdes.type = CNAME;
+    sdes.ssrc = d_own_ssrc;
+    sdes.mlen = std::min(d_cname.size(), sizeof(sdes.message) - 1);
+    memcpy(sdes.message, d_cname.data(), sdes.mlen);
+    dp = gen_sdes(dp, buffer + sizeof(buffer) - dp, d_own_ssrc, &sdes, 1);
+    if (dp != NULL) {
+        send(d_out_fd, buffer, dp - buffer, MSG_DONTWAIT);
+    }
+}
+
+} // namespace rtp
+} // namespace gr
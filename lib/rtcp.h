@@ -0,0 +1,103 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 Franco Venturi.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_RTP_RTCP_H
+#define INCLUDED_RTP_RTCP_H
+
+#include <gnuradio/logger.h>
+#include <gnuradio/thread/thread.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "rtp_info.h"
+#include "rx_batch.h"
+#include "stream_stats.h"
+
+namespace gr {
+namespace rtp {
+
+// RTCP for one received RTP stream (RFC 3550)
+// A background thread listens on the RTCP port of the group (RTP port + 1)
+// for the sender reports of the stream, which map its RTP timestamps to NTP
+// wall clock time, and sends receiver reports with the packet loss and the
+// interarrival jitter to the same port every Report_interval seconds
+// (randomized, on average). The receive path accounts for every packet with
+// received(); those statistics are only ever written by that thread, so
+// they are kept in relaxed atomics instead of behind a lock.
+// The group is resolved and joined in the background, retried every
+// Retry_interval until it works.
+class rtcp_receiver
+{
+public:
+    static constexpr int Report_interval = 5; // seconds
+    static constexpr int Retry_interval = 10; // seconds
+    static constexpr int Ttl = 1;             // receiver reports stay on the local network
+
+    rtcp_receiver(const std::string& target, const gr::logger_ptr& logger);
+    ~rtcp_receiver();
+
+    // Account for an RTP packet that arrived at arrival_ns (ns since the epoch)
+    // A new SSRC restarts the statistics. Call from a single thread
+    void received(rtp_info const& rtp, int64_t arrival_ns);
+
+    // Wall clock time of RTP timestamp of stream ssrc, from its last sender report
+    // Returns false if there is none yet, or the sample rate is unknown
+    bool wall_time(uint32_t ssrc,
+                   uint32_t timestamp,
+                   int samprate,
+                   std::chrono::system_clock::time_point& t) const;
+
+    // Number of sender reports received for the stream (changes with each one)
+    uint32_t sender_reports() const { return d_sender_reports.load(std::memory_order_acquire); }
+
+    // Interarrival jitter in ms (0 until the sample rate is known)
+    float jitter_ms() const { return d_jitter.ms(); }
+
+private:
+    void run();
+    bool setup();
+    void receive_reports();
+    void send_report();
+
+    std::string const d_target;
+    gr::logger_ptr d_logger;
+    uint32_t d_own_ssrc; // for our receiver reports
+    std::string d_cname;
+    int d_in_fd;  // sender reports
+    int d_out_fd; // receiver reports
+
+    // reception statistics (RFC 3550 A.1, A.3 and A.8)
+    std::atomic<uint32_t> d_ssrc;     // 0 = no packets yet
+    std::atomic<uint32_t> d_base_seq; // extended sequence numbers
+    std::atomic<uint32_t> d_max_seq;
+    std::atomic<uint64_t> d_received;
+    interarrival_jitter d_jitter;
+    uint32_t d_report_ssrc;           // at the previous report (our thread)
+    uint32_t d_expected_prior;
+    uint64_t d_received_prior;
+
+    // last sender report of the stream
+    mutable gr::thread::mutex d_sr_mutex;
+    uint32_t d_sr_ssrc;
+    uint32_t d_sr_rtp_timestamp;
+    uint64_t d_sr_ntp;                // NTP timestamp
+    std::chrono::system_clock::time_point d_sr_time; // the same, as wall clock time
+    int64_t d_sr_arrival_ns;
+    std::atomic<uint32_t> d_sender_reports;
+
+    gr::thread::thread d_thread;
+    std::atomic<bool> d_stop;
+    rx_wakeup d_wake;
+};
+
+} // namespace rtp
+} // namespace gr
+
+#endif /* INCLUDED_RTP_RTCP_H */
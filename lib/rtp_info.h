@@ -0,0 +1,112 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 Franco Venturi.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_RTP_RTP_INFO_H
+#define INCLUDED_RTP_RTP_INFO_H
+
+#include <arpa/inet.h>
+#include <cstdint>
+#include <cstring>
+
+#include "multicast.h"
+
+namespace gr {
+namespace rtp {
+
+// The RTP header fields the receive path uses, in 12 bytes
+// (struct rtp_header carries the CSRC list too, which makes it 84 bytes)
+// This is what the sessions and their jitter buffers work with.
+struct rtp_info {
+    uint32_t ssrc;
+    uint32_t timestamp;
+    uint16_t seq;
+    uint8_t type;
+    bool marker;
+};
+
+static inline rtp_info make_rtp_info(struct rtp_header const& rtp)
+{
+    rtp_info info;
+    info.ssrc = rtp.ssrc;
+    info.timestamp = rtp.timestamp;
+    info.seq = rtp.seq;
+    info.type = rtp.type;
+    info.marker = rtp.marker;
+    return info;
+}
+
+// Results of parse_rtp() other than a payload size
+static int const Rtp_invalid = 0;   // not RTP, truncated header, or no payload
+static int const Rtp_unwanted = -1; // SSRC 0 or not the one asked for
+
+// Parse the RTP header of datagram data[len] into info
+// want_ssrc != 0 rejects the other SSRCs before anything else is decoded:
+// with many streams on a group, that's what most datagrams come to.
+// The header ka9q-radio sends (version 2, no padding, no extension and no
+// CSRCs) is recognized with one compare on the first byte; anything else
+// goes through ntoh_rtp(), after checking that the CSRC list, the extension
+// and the padding all fit in the datagram.
+// Returns the payload size (with *payload pointing to it), or Rtp_invalid
+// or Rtp_unwanted
+static inline int parse_rtp(uint8_t const *data,
+                            int len,
+                            uint32_t want_ssrc,
+                            rtp_info& info,
+                            uint8_t const **payload)
+{
+    if (len <= RTP_MIN_SIZE) {
+        return Rtp_invalid;
+    }
+    uint32_t word;
+    memcpy(&word, data + 8, sizeof(word));
+    uint32_t const ssrc = ntohl(word);
+    if (ssrc == 0 || (want_ssrc != 0 && ssrc != want_ssrc)) {
+        return Rtp_unwanted;
+    }
+    memcpy(&word, data, sizeof(word));
+    word = ntohl(word);
+
+    if ((word >> 24) == 0x80) {
+        // Fast path: fixed header only
+        info.ssrc = ssrc;
+        info.type = (word >> 16) & 0x7f;
+        info.marker = (word >> 23) & 1;
+        info.seq = word & 0xffff;
+        memcpy(&word, data + 4, sizeof(word));
+        info.timestamp = ntohl(word);
+        *payload = data + RTP_MIN_SIZE;
+        return len - RTP_MIN_SIZE;
+    }
+
+    if ((word >> 30) != 2) {
+        return Rtp_invalid;
+    }
+    int header = RTP_MIN_SIZE + 4 * ((word >> 24) & 0xf); // CSRCs
+    if (word & (1 << 28)) {
+        // Extension: 4 byte header, then its length in 32 bit words
+        if (header + 4 > len) {
+            return Rtp_invalid;
+        }
+        header += 4 + 4 * ((data[header + 2] << 8) | data[header + 3]);
+    }
+    int size = len - header;
+    if (word & (1 << 29)) {
+        size -= data[len - 1]; // Padding (its length is in the last byte)
+    }
+    if (size <= 0) {
+        return Rtp_invalid;
+    }
+    struct rtp_header rtp;
+    *payload = static_cast<uint8_t const *>(ntoh_rtp(&rtp, data));
+    info = make_rtp_info(rtp);
+    return size;
+}
+
+} // namespace rtp
+} // namespace gr
+
+#endif /* INCLUDED_RTP_RTP_INFO_H */
@@ -0,0 +1,229 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 Franco Venturi.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_RTP_RX_BATCH_H
+#define INCLUDED_RTP_RX_BATCH_H
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <vector>
+
+#include "packet_arena.h"
+
+namespace gr {
+namespace rtp {
+
+// A batch of datagrams read with a single recvmmsg() call
+// Buffers are either owned by the batch (buffer_size > 0, or allocate()), in a
+// packet arena, or bound to external storage (e.g. ring slots) with bind()
+// before each receive()
+// With timestamps, the batch also collects the kernel receive time of each
+// datagram (when SO_TIMESTAMPNS is set on the socket) and the time
+// recvmmsg() returned
+class rx_batch
+{
+public:
+    rx_batch(int size, int buffer_size, bool timestamps = false)
+        : d_size(size),
+          d_senders(size),
+          d_iovecs(size),
+          d_msgs(size),
+          d_timestamps(timestamps),
+          d_control(timestamps ? size * Control_size : 0),
+          d_recv_ns(0),
+          d_truncations(0)
+    {
+        if (buffer_size > 0) {
+            allocate(buffer_size);
+        }
+    }
+
+    int size() const { return d_size; }
+
+    // (Re)allocate our own buffers, for datagrams of up to buffer_size bytes
+    // (see packet_arena::slot_size_for())
+    void allocate(int buffer_size)
+    {
+        d_buffers = std::make_unique<packet_arena>(d_size, buffer_size);
+        for (int i = 0; i < d_size; i++) {
+            bind(i, d_buffers->slot(i), d_buffers->slot_size(), &d_senders[i]);
+        }
+    }
+
+    // Use external storage for entry i
+    void bind(int i, void *data, int len, struct sockaddr_storage *sender)
+    {
+        d_iovecs[i].iov_base = data;
+        d_iovecs[i].iov_len = len;
+        d_msgs[i].msg_hdr.msg_name = sender;
+    }
+
+    // Read up to n (<= size()) datagrams from fd
+    // When wait is true, block (up to the socket timeout) for the first one
+    // Returns the number of datagrams received, 0 if none are available
+    int receive(int fd, int n, bool wait)
+    {
+        for (int i = 0; i < n; i++) {
+            struct msghdr& hdr = d_msgs[i].msg_hdr;
+            hdr.msg_namelen = sizeof(struct sockaddr_storage);
+            hdr.msg_iov = &d_iovecs[i];
+            hdr.msg_iovlen = 1;
+            hdr.msg_control = d_timestamps ? &d_control[i * Control_size] : NULL;
+            hdr.msg_controllen = d_timestamps ? Control_size : 0;
+            hdr.msg_flags = 0;
+        }
+        int const count = recvmmsg(fd, d_msgs.data(), n,
+                                   wait ? MSG_WAITFORONE : MSG_DONTWAIT, NULL);
+        if (count == -1) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                perror("recvmmsg");
+            }
+            return 0;
+        }
+        if (d_timestamps) {
+            d_recv_ns = now_ns();
+        }
+        for (int i = 0; i < count; i++) {
+            if (truncated(i)) {
+                d_truncations.store(truncations() + 1, std::memory_order_relaxed);
+            }
+        }
+        return count;
+    }
+
+    uint8_t const *data(int i) const
+    {
+        return static_cast<uint8_t const *>(d_iovecs[i].iov_base);
+    }
+    // Length of datagram i, 0 if it was truncated (bigger than its buffer):
+    // decoding part of it would only garble the output
+    int len(int i) const { return truncated(i) ? 0 : d_msgs[i].msg_len; }
+    // Whether datagram i was bigger than its buffer (its header is still there)
+    bool truncated(int i) const { return d_msgs[i].msg_hdr.msg_flags & MSG_TRUNC; }
+    struct sockaddr const *sender(int i) const
+    {
+        return static_cast<struct sockaddr const *>(d_msgs[i].msg_hdr.msg_name);
+    }
+
+    // Kernel receive time of datagram i in ns since the epoch (0 = unknown)
+    int64_t kernel_ns(int i) const
+    {
+        if (!d_timestamps) {
+            return 0;
+        }
+        struct msghdr const *hdr = &d_msgs[i].msg_hdr;
+        for (struct cmsghdr const *cmsg = CMSG_FIRSTHDR(hdr); cmsg != NULL;
+             cmsg = CMSG_NXTHDR(const_cast<struct msghdr *>(hdr),
+                                const_cast<struct cmsghdr *>(cmsg))) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+                struct timespec ts;
+                memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+                return int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+            }
+        }
+        return 0;
+    }
+
+    // Time the last receive() returned, in ns since the epoch (0 = unknown)
+    int64_t recv_ns() const { return d_recv_ns; }
+
+    // Number of datagrams received truncated so far (readable from any thread)
+    uint64_t truncations() const { return d_truncations.load(std::memory_order_relaxed); }
+
+    static int64_t now_ns()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+private:
+    static int const Control_size = CMSG_SPACE(sizeof(struct timespec));
+
+    int const d_size;
+    std::unique_ptr<packet_arena> d_buffers;
+    std::vector<struct sockaddr_storage> d_senders;
+    std::vector<struct iovec> d_iovecs;
+    std::vector<struct mmsghdr> d_msgs;
+    bool const d_timestamps;
+    std::vector<uint8_t> d_control;
+    int64_t d_recv_ns;
+    std::atomic<uint64_t> d_truncations;
+};
+
+// Lets a receiver thread sleep on its socket with no timeout
+// wait() polls the socket together with an eventfd, and notify() (from any
+// thread) makes it return, e.g. to stop the receiver or to have it poll a
+// socket that was just dup2()'d onto the one it was waiting on.
+class rx_wakeup
+{
+public:
+    rx_wakeup() : d_fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+    {
+        if (d_fd == -1) {
+            perror("eventfd");
+        }
+    }
+    ~rx_wakeup()
+    {
+        if (d_fd != -1) {
+            close(d_fd);
+        }
+    }
+    rx_wakeup(const rx_wakeup&) = delete;
+    rx_wakeup& operator=(const rx_wakeup&) = delete;
+
+    // Make wait() return (thread safe)
+    void notify()
+    {
+        uint64_t const one = 1;
+        if (write(d_fd, &one, sizeof(one)) == -1 && errno != EAGAIN) {
+            perror("eventfd write");
+        }
+    }
+
+    // Block until fd is readable, notify() is called or timeout_ms have passed
+    // (-1 = no timeout; fd -1 just waits)
+    // Returns true if fd is readable
+    bool wait(int fd, int timeout_ms = -1)
+    {
+        struct pollfd pfd[2] = { { fd, POLLIN, 0 }, { d_fd, POLLIN, 0 } };
+        // without the eventfd, fall back to checking for stop now and then
+        if (d_fd == -1 && (timeout_ms < 0 || timeout_ms > Fallback_timeout_ms)) {
+            timeout_ms = Fallback_timeout_ms;
+        }
+        if (poll(pfd, d_fd == -1 ? 1 : 2, timeout_ms) <= 0) {
+            return false; // timeout or EINTR
+        }
+        if (pfd[1].revents & POLLIN) {
+            uint64_t count;
+            if (read(d_fd, &count, sizeof(count)) == -1 && errno != EAGAIN) {
+                perror("eventfd read");
+            }
+        }
+        return pfd[0].revents != 0;
+    }
+
+private:
+    static int const Fallback_timeout_ms = 100;
+
+    int const d_fd;
+};
+
+} // namespace rtp
+} // namespace gr
+
+#endif /* INCLUDED_RTP_RX_BATCH_H */
@@ -0,0 +1,815 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 Franco Venturi.
+ * Copyright 2023 Phil Karn, KA9Q
+ *
+ * based on:
+ * - pcmcat in ka9q-radio
+ * - wavfile_source block in GNU Radio
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "session.h"
+#include "convert.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+namespace gr {
+namespace rtp {
+
+// Config constants
+static int const Default_jitter_packets = 64; // when only the latency is given
+static int const Max_zero_fill = 10;          // seconds: longer gaps start a new timeline
+static int const Max_zero_fill_frames = 48000 * Max_zero_fill; // when the rate is unknown
+static int const Max_misorder = 100;   // packets: further back, the sender restarted (RFC 3550 A.1)
+static int const Max_dropout = 3000;   // packets: further ahead, the sender restarted
+
+static const pmt::pmt_t Rx_time_key = pmt::string_to_symbol("rx_time");
+static const pmt::pmt_t Rx_rate_key = pmt::string_to_symbol("rx_rate");
+static const pmt::pmt_t Rtp_gap_key = pmt::string_to_symbol("rtp_gap");
+static const pmt::pmt_t Rx_freq_key = pmt::string_to_symbol("rx_freq");
+
+// internal functions defined below
+static void init(struct pcmstream *pc, rtp_info const *rtp,
+                 struct sockaddr const *sender);
+
+template <typename T>
+session<T>::session(int channels,
+                    bool quiet,
+                    const gr::logger_ptr& logger,
+                    int jitter_packets,
+                    int jitter_ms)
+    : pcmstream{}, // Init with zeros
+      channels(channels),
+      quiet(quiet),
+      logger(logger),
+      format_type(-1),
+      format(payload_format_from_pt(-1)),
+      channels_warned(false),
+      jitter_latency(jitter_ms),
+      max_seq(0),
+      stats(std::make_unique<stream_stats>()),
+      events(logger),
+      carry_zeroes(0),
+      carry_pos(0),
+      carry_end(0),
+      tag_block(NULL),
+      tag_port(0),
+      tag_pending(false),
+      samprate(0),
+      anchor_frames(0),
+      sender_clock(NULL),
+      sender_reports(0),
+      status(NULL),
+      status_updates(0),
+      stream_samprate(0),
+      stream_channels(0),
+      stream_encoding(0),
+      frequency(0)
+{
+    if (jitter_packets > 0 || jitter_ms > 0) {
+        jitter = std::make_unique<jitter_buffer>(jitter_packets > 0 ? jitter_packets
+                                                                    : Default_jitter_packets);
+    }
+}
+
+template <typename T>
+void session<T>::set_packet_size(int size)
+{
+    if (jitter) {
+        jitter = std::make_unique<jitter_buffer>(jitter->depth(), size);
+    }
+}
+
+template <typename T>
+void session<T>::set_format(int type)
+{
+    format_type = type;
+    format = payload_format_from_pt(type);
+    if (format.channels == 0 && format.enc != encoding::NONE && stream_encoding != 0) {
+        // a dynamic payload type, that only radiod can tell the encoding of
+        format = status_format(stream_encoding);
+    }
+    samprate = stream_samprate > 0 ? stream_samprate : samprate_from_pt(type);
+    if (format.enc == encoding::NONE) {
+        logger->warn("Unsupported RTP payload type {} - dropping packets", type);
+    } else if (format.channels != 0 && format.channels != channels && !channels_warned) {
+        logger->warn("RTP payload type {} has {} channels - configured for {}",
+                     type, format.channels, channels);
+        channels_warned = true;
+    }
+}
+
+// Take in the latest radiod status of the stream
+template <typename T>
+void session<T>::update_status()
+{
+    status_updates = status->updates();
+    channel_status s;
+    if (!status->get(pcmstream.ssrc, s) ||
+        (s.samprate == stream_samprate && s.channels == stream_channels &&
+         s.output_encoding == stream_encoding && s.frequency == frequency)) {
+        return;
+    }
+    if (s.samprate != stream_samprate || s.frequency != frequency) {
+        tag_pending = true; // new rate or frequency from here on
+    }
+    stream_samprate = s.samprate;
+    stream_channels = s.channels;
+    frequency = s.frequency;
+    samprate = stream_samprate > 0 ? stream_samprate : samprate_from_pt(format_type);
+    if (s.output_encoding != stream_encoding) {
+        stream_encoding = s.output_encoding;
+        if (format_type != -1) {
+            set_format(format_type); // may be the one telling the encoding
+        }
+    }
+    if (!quiet) {
+        logger->info("Stream {}: {} Hz, {} channels, frequency {} Hz",
+                     s.ssrc, s.samprate, s.channels, s.frequency);
+    }
+}
+
+template <typename T>
+bool session<T>::process(rtp_info const *rtp,
+                         uint8_t const *dp,
+                         int size,
+                         struct sockaddr const *sender,
+                         T** outs,
+                         int noutput_items,
+                         int noutput_channels,
+                         int& produced,
+                         int64_t arrival_ns)
+{
+    if (carrying() && !flush_carry(outs, noutput_items, noutput_channels, produced)) {
+        return false; // still catching up
+    }
+    if (pcmstream.ssrc == 0) {
+        // First packet on stream, initialize
+        init(&pcmstream, rtp, sender);
+        restart(rtp->seq);
+        stats->jitter.reset();
+        if (status != NULL) {
+            status->want(pcmstream.ssrc);
+        }
+
+        if (!quiet) {
+            logger->info("New session from {}@{}",
+                         pcmstream.ssrc,
+                         formatsock(&pcmstream.sender));
+        }
+    } else if (rtp->ssrc != pcmstream.ssrc) {
+        return true; // unwanted SSRC, ignore
+    }
+
+    if (!address_match(sender, &pcmstream.sender) || getportnumber(&pcmstream.sender) != getportnumber(sender)) {
+        // Source changed, the sender restarted
+        init(&pcmstream, rtp, sender);
+        restart(rtp->seq);
+        if (!quiet) {
+            logger->info("Session restart from {}@{}",
+                         pcmstream.ssrc,
+                         formatsock(&pcmstream.sender));
+        }
+    }
+
+    if (!(jitter ? reorder(rtp, dp, size, outs, noutput_items, noutput_channels, produced)
+                 : play(rtp, dp, size, outs, noutput_items, noutput_channels, produced))) {
+        return false;
+    }
+    account(rtp, size, arrival_ns);
+    return true;
+}
+
+// Put the packet in sequence order in the jitter buffer; first play whatever
+// is already due, then whatever it makes due
+// Returns false, without using the packet, if it doesn't fit in the output buffer
+template <typename T>
+bool session<T>::reorder(rtp_info const *rtp,
+                         uint8_t const *dp,
+                         int size,
+                         T** outs,
+                         int noutput_items,
+                         int noutput_channels,
+                         int& produced)
+{
+    if (!release(outs, noutput_items, noutput_channels, produced)) {
+        return false;
+    }
+    int offset = jitter->offset(rtp->seq);
+    if ((rtp->marker && offset < 0) || offset < -Max_misorder || offset >= Max_dropout) {
+        // A sequence jump, not a late packet: the sender restarted (radiod
+        // from the same address and port); play what's held and start over
+        while (!jitter->empty()) {
+            if (!release_head(outs, noutput_items, noutput_channels, produced)) {
+                return false;
+            }
+        }
+        restart(rtp->seq);
+        pcmstream.rtp_state.seq = rtp->seq;
+        pcmstream.rtp_state.timestamp = rtp->timestamp;
+        if (!quiet) {
+            logger->info("Session restart from {}@{}",
+                         pcmstream.ssrc,
+                         formatsock(&pcmstream.sender));
+        }
+        offset = jitter->offset(rtp->seq);
+    }
+    if (offset < 0) {
+        stream_stats::add(stats->late, 1); // its turn has passed
+        return true;
+    }
+    while (offset >= jitter->depth()) {
+        // Too far ahead: make room, giving up on the oldest holes
+        if (jitter->empty()) {
+            int const n = offset - jitter->depth() + 1;
+            stream_stats::add(stats->lost, n);
+            jitter->skip(n);
+        } else if (!release_head(outs, noutput_items, noutput_channels, produced)) {
+            return false;
+        }
+        offset = jitter->offset(rtp->seq);
+    }
+    if (jitter->at(offset) != NULL) {
+        stream_stats::add(stats->dupes, 1);
+        return true;
+    }
+
+    if (offset == 0 && jitter->empty()) {
+        // In order, nothing held: play it straight from the caller's buffer
+        if (!play(rtp, dp, size, outs, noutput_items, noutput_channels, produced)) {
+            return false;
+        }
+        jitter->advance();
+    } else if (size > jitter->slot_size()) {
+        oversize(1); // too big to hold: don't play it truncated
+        return true;
+    } else {
+        jitter->store(offset, *rtp, dp, size, jitter_buffer::clock::now());
+    }
+    if (static_cast<int16_t>(rtp->seq - max_seq) < 0) {
+        stream_stats::add(stats->reordered, 1); // a later packet got here first
+    }
+    release(outs, noutput_items, noutput_channels, produced);
+    return true;
+}
+
+// Count a packet of the stream that process() took
+template <typename T>
+void session<T>::account(rtp_info const *rtp, int size, int64_t arrival_ns)
+{
+    stream_stats::add(stats->packets, 1);
+    stream_stats::add(stats->bytes, size);
+    int const behind = static_cast<int16_t>(max_seq - rtp->seq);
+    if (behind > 0) {
+        stats->reordered_by(behind);
+    } else {
+        max_seq = rtp->seq;
+    }
+    stats->jitter.update(rtp->timestamp,
+                         samprate > 0 ? samprate : samprate_from_pt(rtp->type),
+                         arrival_ns != 0 ? arrival_ns : rx_batch::now_ns());
+    events.poll();
+}
+
+template <typename T>
+void session<T>::drain(T** outs, int noutput_items, int noutput_channels, int& produced)
+{
+    if (carrying() && !flush_carry(outs, noutput_items, noutput_channels, produced)) {
+        events.poll();
+        return;
+    }
+    if (jitter) {
+        release(outs, noutput_items, noutput_channels, produced);
+    }
+    events.poll();
+}
+
+template <typename T>
+void session<T>::restart(uint16_t seq)
+{
+    tag_pending = true;
+    max_seq = seq;
+    if (jitter) {
+        jitter->reset(seq);
+    }
+}
+
+// Output what was carried over from the previous calls, as much as fits
+// Returns false if some of it is still left
+template <typename T>
+bool session<T>::flush_carry(T** outs, int noutput_items, int noutput_channels, int& produced)
+{
+    if (carry_zeroes > 0) {
+        int const n = std::min(carry_zeroes, noutput_items - produced);
+        for (int i = 0; i < noutput_channels; i++) {
+            std::fill_n(outs[i] + produced, n, T(0));
+        }
+        produced += n;
+        carry_zeroes -= n;
+        if (carry_zeroes > 0) {
+            return false;
+        }
+    }
+    int const n = std::min(carry_end - carry_pos, noutput_items - produced);
+    for (int i = 0; i < noutput_channels; i++) {
+        std::copy_n(carry[i].data() + carry_pos, n, outs[i] + produced);
+    }
+    produced += n;
+    carry_pos += n;
+    return carry_pos == carry_end;
+}
+
+// Play the packets that are due, in order
+// A hole stops playout until the buffer fills up or it is older than the latency
+// Returns false if a packet doesn't fit in the output buffer
+template <typename T>
+bool session<T>::release(T** outs, int noutput_items, int noutput_channels, int& produced)
+{
+    while (!jitter->empty()) {
+        if (jitter->head() == NULL && (jitter_latency <= 0 ||
+                                       jitter_buffer::clock::now() - jitter->oldest_arrival() <
+                                           std::chrono::milliseconds(jitter_latency))) {
+            return true; // wait for it
+        }
+        if (!release_head(outs, noutput_items, noutput_channels, produced)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Play the head packet, or give up on it if it is missing
+// The RTP timestamps take care of zero-filling the hole
+template <typename T>
+bool session<T>::release_head(T** outs, int noutput_items, int noutput_channels, int& produced)
+{
+    auto e = jitter->head();
+    if (e == NULL) {
+        stream_stats::add(stats->lost, 1);
+    } else if (!play(&e->rtp, e->data, e->size, outs, noutput_items, noutput_channels, produced)) {
+        return false;
+    }
+    jitter->advance();
+    return true;
+}
+
+// Output one packet, in order
+template <typename T>
+bool session<T>::play(rtp_info const *rtp,
+                      uint8_t const *dp,
+                      int size,
+                      T** outs,
+                      int noutput_items,
+                      int noutput_channels,
+                      int& produced)
+{
+    if (rtp->type != format_type) {
+        set_format(rtp->type);
+    }
+    if (status != NULL && (tag_pending || status->updates() != status_updates)) {
+        update_status();
+    }
+    if (format.enc == encoding::NONE) {
+        return true; // can't decode it, ignore
+    }
+    // the payload type knows better than radiod, and radiod better than the
+    // configuration, if they say anything
+    int const channels = format.channels != 0 ? format.channels
+                         : stream_channels != 0 ? stream_channels
+                                                : this->channels;
+
+    if (rtp->marker) {
+        pcmstream.rtp_state.timestamp = rtp->timestamp;      // Resynch
+        tag_pending = true;
+    }
+    if (sender_clock != NULL && sender_clock->sender_reports() != sender_reports) {
+        // New sender report: tag the sender's time from here on
+        sender_reports = sender_clock->sender_reports();
+        tag_pending = true;
+    }
+
+    int const sampcount = payload_samples(format.enc, size); // # of samples, regardless of mono or stereo
+    int const framecount = sampcount / channels; // == sampcount for mono, sampcount/2 for stereo
+    int const items_per_frame = get_output_items(channels, channels, noutput_channels, 0);
+    int offset = produced;
+
+    int const time_step = rtp->timestamp - pcmstream.rtp_state.timestamp;
+    int const max_zero_fill = samprate > 0 ? samprate * Max_zero_fill : Max_zero_fill_frames;
+    int const zero_frames = time_step <= max_zero_fill ? std::max(time_step, 0) : 0;
+    int const nexpected_output_items = get_output_items(sampcount, channels, noutput_channels, zero_frames);
+    bool const fits = produced + nexpected_output_items <= noutput_items;
+    if (!fits && produced > 0) {
+        return false; // Doesn't fit; keep it for the next call
+    }
+    // else if it doesn't fit, even in an empty buffer, what's left over is
+    // carried over to the next calls
+    int const seq_step = static_cast<int16_t>(rtp->seq - pcmstream.rtp_state.seq);
+    if (seq_step > 0) {
+        stream_stats::add(stats->drops, seq_step); // never got here, or given up on
+    }
+
+    if (time_step < 0) {
+        // Old dupe
+        stream_stats::add(stats->dupes, 1);
+        events.record(event_log::Out_of_order, framecount);
+        return true;
+    } else if (time_step > 0) {
+        events.record(event_log::Gap, time_step);
+        if (zero_frames == 0) {
+            tag_pending = true; // too long to fill: new timeline
+        } else {
+            int const start = offset;
+            if (fits) {
+                offset = output_zeroes(zero_frames, channels, outs,
+                                       noutput_items, noutput_channels, offset);
+            } else {
+                carry_zeroes = get_output_items(0, channels, noutput_channels, zero_frames);
+                offset += carry_zeroes;
+            }
+            int const frames = (offset - start) / items_per_frame;
+            stream_stats::add(stats->zero_filled, frames);
+            if (tag_block != NULL && !tag_pending) {
+                add_tags(start, noutput_channels, anchor_frames, frames);
+            }
+            anchor_frames += frames;
+        }
+        // Resync
+        pcmstream.rtp_state.timestamp = rtp->timestamp; // Bring up to date?
+    }
+
+    if (tag_pending) {
+        // New timeline: the sender report says when the packet's first frame
+        // was sampled; without one, about one packet duration before it got here
+        if (sender_clock == NULL ||
+            !sender_clock->wall_time(rtp->ssrc, rtp->timestamp, samprate, anchor_time)) {
+            anchor_time = std::chrono::system_clock::now();
+            if (samprate > 0) {
+                anchor_time -= std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                    std::chrono::duration<double>(double(framecount) / samprate));
+            }
+        }
+        anchor_frames = 0;
+        if (tag_block != NULL) {
+            add_tags(offset, noutput_channels, 0, -1);
+        }
+        tag_pending = false;
+    }
+
+    if (fits) {
+        produced = output_samples(dp, format.enc, sampcount, channels, outs,
+                                  noutput_items, noutput_channels, offset);
+        anchor_frames += (produced - offset) / items_per_frame;
+    } else {
+        // Decode it all into the carry-over buffer (tags already have the
+        // offsets the items will have), and output what fits
+        int const nitems = nexpected_output_items - carry_zeroes;
+        carry.resize(noutput_channels);
+        std::vector<T*> stage(noutput_channels);
+        for (int i = 0; i < noutput_channels; i++) {
+            carry[i].resize(std::max<size_t>(carry[i].size(), nitems));
+            stage[i] = carry[i].data();
+        }
+        carry_pos = 0;
+        carry_end = output_samples(dp, format.enc, sampcount, channels, stage.data(),
+                                   nitems, noutput_channels, 0);
+        anchor_frames += carry_end / items_per_frame;
+        flush_carry(outs, noutput_items, noutput_channels, produced);
+    }
+
+    pcmstream.rtp_state.timestamp += framecount;
+    pcmstream.rtp_state.seq = rtp->seq + 1;
+    return true;
+}
+
+// Tag output item offset with the time of frame number frames in the current
+// timeline (and with the gap length if gap >= 0)
+template <typename T>
+void session<T>::add_tags(int offset, int noutput_channels, uint64_t frames, int gap)
+{
+    auto t = anchor_time;
+    if (samprate > 0) {
+        t += std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::duration<double>(double(frames) / samprate));
+    } else if (gap >= 0) {
+        t = std::chrono::system_clock::now(); // no clock to count on
+    }
+    auto const since_epoch = t.time_since_epoch();
+    auto const secs = std::chrono::duration_cast<std::chrono::seconds>(since_epoch);
+    double const frac = std::chrono::duration<double>(since_epoch - secs).count();
+    pmt::pmt_t const time = pmt::make_tuple(pmt::from_uint64(secs.count()), pmt::from_double(frac));
+
+    for (int i = 0; i < noutput_channels; i++) {
+        int const port = tag_port + i;
+        uint64_t const item = tag_block->nitems_written(port) + offset;
+        tag_block->add_item_tag(port, item, Rx_time_key, time);
+        if (samprate > 0) {
+            tag_block->add_item_tag(port, item, Rx_rate_key, pmt::from_double(samprate));
+        }
+        if (frequency > 0) {
+            tag_block->add_item_tag(port, item, Rx_freq_key, pmt::from_double(frequency));
+        }
+        if (gap >= 0) {
+            tag_block->add_item_tag(port, item, Rtp_gap_key, pmt::from_uint64(gap));
+        }
+    }
+}
+
+template<>
+void session<gr_complex>::check_out_channels(int channels) const
+{
+    if (channels > 1) {
+        throw std::runtime_error("gr_complex requires only 1 output");
+    }
+}
+
+template<>
+int session<std::int16_t>::get_output_items(int sampcount, int channels, int noutput_channels, int time_step) const
+{
+    if (channels == 2 && noutput_channels == 1) {
+        return time_step * channels + sampcount;  // interleaved short case
+    } else {
+        return time_step + sampcount / channels;  // == sampcount for mono, sampcount/2 for stereo
+    }
+}
+
+template <>
+int session<gr_complex>::output_zeroes(int nzeroes,
+                                           int channels,
+                                           gr_complex** outs,
+                                           int noutput_items,
+                                           int noutput_channels,
+                                           int offset) const
+{
+    auto out = outs[0];
+
+    if (offset + nzeroes > noutput_items) {
+        events.record(event_log::Truncated, offset + nzeroes - noutput_items);
+        nzeroes = noutput_items - offset;
+    }
+
+    std::fill_n(out + offset, nzeroes, 0);
+    return offset + nzeroes;
+}
+
+template <>
+int session<float>::output_zeroes(int nzeroes,
+                                      int channels,
+                                      float** outs,
+                                      int noutput_items,
+                                      int noutput_channels,
+                                      int offset) const
+{
+    if (offset + nzeroes > noutput_items) {
+        events.record(event_log::Truncated, offset + nzeroes - noutput_items);
+        nzeroes = noutput_items - offset;
+    }
+    if (noutput_channels == 1) {
+        auto out = outs[0];
+        std::fill_n(out + offset, nzeroes, 0);
+    } else if (noutput_channels == 2) {
+        auto out_left = outs[0];
+        auto out_right = outs[1];
+        std::fill_n(out_left + offset, nzeroes, 0);
+        std::fill_n(out_right + offset, nzeroes, 0);
+    } else {
+        nzeroes = 0;
+    }
+    return offset + nzeroes;
+}
+
+template <>
+int session<std::int16_t>::output_zeroes(int nzeroes,
+                                             int channels,
+                                             std::int16_t** outs,
+                                             int noutput_items,
+                                             int noutput_channels,
+                                             int offset) const
+{
+    // interleaved short case
+    if (channels == 2 && noutput_channels == 1) {
+        nzeroes *= 2;
+    }
+    if (offset + nzeroes > noutput_items) {
+        events.record(event_log::Truncated, offset + nzeroes - noutput_items);
+        nzeroes = noutput_items - offset;
+        // interleaved short case - make sure nzeroes is even
+        if (channels == 2 && noutput_channels == 1) {
+            nzeroes -= nzeroes % 2;
+        }
+    }
+    if (noutput_channels == 1) {
+        auto out = outs[0];
+        std::fill_n(out + offset, nzeroes, 0);
+    } else if (noutput_channels == 2) {
+        auto out_left = outs[0];
+        auto out_right = outs[1];
+        std::fill_n(out_left + offset, nzeroes, 0);
+        std::fill_n(out_right + offset, nzeroes, 0);
+    } else {
+        nzeroes = 0;
+    }
+    return offset + nzeroes;
+}
+
+template <>
+int session<gr_complex>::output_samples(const void *dp,
+                                            encoding enc,
+                                            int sampcount,
+                                            int channels,
+                                            gr_complex** outs,
+                                            int noutput_items,
+                                            int noutput_channels,
+                                            int offset)
+{
+    auto out = outs[0];
+
+    int samples = sampcount / channels;
+    if (offset + samples > noutput_items) {
+        events.record(event_log::Truncated, offset + samples - noutput_items);
+        samples = noutput_items - offset;
+    }
+
+    auto fout = reinterpret_cast<float *>(out + offset);
+    if (channels == 1) {
+        if (enc == encoding::S16BE) {
+            convert_s16be_cf32_real(dp, fout, samples);
+        } else {
+            // Decode into the upper half of the output, then spread the
+            // samples out forward: each write lands on samples already read
+            decode_f32(enc, dp, fout + samples, samples);
+            for (int i = 0; i < samples; i++) {
+                float const re = fout[samples + i];
+                fout[2 * i] = re;
+                fout[2 * i + 1] = 0.0f;
+            }
+        }
+    } else if (channels == 2) {
+        // I/Q pairs are laid out like gr_complex
+        decode_f32(enc, dp, fout, 2 * samples);
+    } else {
+        samples = 0;
+    }
+
+    return offset + samples;
+}
+
+template <>
+int session<float>::output_samples(const void *dp,
+                                       encoding enc,
+                                       int sampcount,
+                                       int channels,
+                                       float** outs,
+                                       int noutput_items,
+                                       int noutput_channels,
+                                       int offset)
+{
+    int samples = sampcount / channels;
+    if (offset + samples > noutput_items) {
+        events.record(event_log::Truncated, offset + samples - noutput_items);
+        samples = noutput_items - offset;
+    }
+
+    if (noutput_channels == 1) {
+        auto out = outs[0];
+        if (channels == 1) {
+            decode_f32(enc, dp, out + offset, samples);
+        } else if (channels == 2) {
+            // Downmix to mono
+            if (enc == encoding::S16BE) {
+                convert_s16be_f32_downmix(dp, out + offset, samples);
+            } else {
+                scratch.resize(2 * samples);
+                decode_f32(enc, dp, scratch.data(), 2 * samples);
+                for (int i = 0; i < samples; i++) {
+                    out[offset + i] = (scratch[2 * i] + scratch[2 * i + 1]) * 0.5f;
+                }
+            }
+        } else {
+            samples = 0;
+        }
+    } else if (noutput_channels == 2) {
+        auto out_left = outs[0];
+        auto out_right = outs[1];
+        if (channels == 1) {
+            // Expand to pseudo-stereo
+            if (enc == encoding::S16BE) {
+                convert_s16be_f32_dup(dp, out_left + offset, out_right + offset, samples);
+            } else {
+                decode_f32(enc, dp, out_left + offset, samples);
+                std::copy_n(out_left + offset, samples, out_right + offset);
+            }
+        } else if (channels == 2) {
+            if (enc == encoding::S16BE) {
+                convert_s16be_f32_deinterleave(dp, out_left + offset, out_right + offset, samples);
+            } else {
+                scratch.resize(2 * samples);
+                decode_f32(enc, dp, scratch.data(), 2 * samples);
+                for (int i = 0; i < samples; i++) {
+                    out_left[offset + i] = scratch[2 * i];
+                    out_right[offset + i] = scratch[2 * i + 1];
+                }
+            }
+        } else {
+            samples = 0;
+        }
+    } else {
+        samples = 0;
+    }
+
+    return offset + samples;
+}
+
+template <>
+int session<std::int16_t>::output_samples(const void *dp,
+                                              encoding enc,
+                                              int sampcount,
+                                              int channels,
+                                              std::int16_t** outs,
+                                              int noutput_items,
+                                              int noutput_channels,
+                                              int offset)
+{
+    int samples = sampcount / channels;
+    // interleaved short case
+    if (channels == 2 && noutput_channels == 1) {
+        samples = sampcount;
+    }
+    if (offset + samples > noutput_items) {
+        events.record(event_log::Truncated, offset + samples - noutput_items);
+        samples = noutput_items - offset;
+    }
+
+    if (noutput_channels == 1) {
+        auto out = outs[0];
+        if (channels == 1 || channels == 2) {
+            // (in) channels == 1 -> standard mono
+            // (in) channels == 2 -> interleaved shorts (for raw I/Q)
+            decode_s16(enc, dp, out + offset, samples);
+        } else {
+            samples = 0;
+        }
+    } else if (noutput_channels == 2) {
+        auto out_left = outs[0];
+        auto out_right = outs[1];
+        if (channels == 1) {
+            // Expand to pseudo-stereo
+            if (enc == encoding::S16BE) {
+                convert_s16be_s16_dup(dp, out_left + offset, out_right + offset, samples);
+            } else {
+                decode_s16(enc, dp, out_left + offset, samples);
+                std::copy_n(out_left + offset, samples, out_right + offset);
+            }
+        } else if (channels == 2) {
+            if (enc == encoding::S16BE) {
+                convert_s16be_s16_deinterleave(dp, out_left + offset, out_right + offset, samples);
+            } else {
+                scratch.resize(2 * samples);
+                decode_s16(enc, dp, scratch.data(), 2 * samples);
+                for (int i = 0; i < samples; i++) {
+                    out_left[offset + i] = scratch[2 * i];
+                    out_right[offset + i] = scratch[2 * i + 1];
+                }
+            }
+        } else {
+            samples = 0;
+        }
+    } else {
+        samples = 0;
+    }
+
+    return offset + samples;
+}
+
+static void init(struct pcmstream *pc, rtp_info const *rtp,
+                 struct sockaddr const *sender) {
+    // First packet on stream, initialize
+    pc->ssrc = rtp->ssrc;
+    pc->type = rtp->type;
+
+    socklen_t const slen = sender->sa_family == AF_INET6 ? sizeof(struct sockaddr_in6)
+                                                         : sizeof(struct sockaddr_in);
+    memset(&pc->sender,0,sizeof(pc->sender));
+    memcpy(&pc->sender,sender,slen); // Remember sender
+    // Numeric only: a reverse DNS lookup here would stall the receive path
+    // (formatsock() resolves the name in the background for the log messages)
+    getnameinfo((struct sockaddr *)&pc->sender, slen,
+                pc->addr,sizeof(pc->addr),
+                pc->port,sizeof(pc->port), NI_NUMERICHOST | NI_NUMERICSERV);
+    pc->rtp_state.timestamp = rtp->timestamp;
+    pc->rtp_state.seq = rtp->seq;
+    pc->rtp_state.packets = 0;
+    pc->rtp_state.bytes = 0;
+    pc->rtp_state.drops = 0;
+    pc->rtp_state.dupes = 0;
+}
+
+template class session<gr_complex>;
+template class session<float>;
+template class session<std::int16_t>;
+} /* namespace rtp */
+} /* namespace gr */
@@ -0,0 +1,210 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 Franco Venturi.
+ *
+ * based on:
+ * - pcmcat in ka9q-radio
+ * - wavfile_source block in GNU Radio
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_RTP_SESSION_H
+#define INCLUDED_RTP_SESSION_H
+
+#include <gnuradio/block.h>
+#include <gnuradio/logger.h>
+#include <gnuradio/types.h>
+
+#include <chrono>
+
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "convert.h"
+#include "event_log.h"
+#include "jitter_buffer.h"
+#include "multicast.h"
+#include "rtcp.h"
+#include "rtp_info.h"
+#include "status_listener.h"
+#include "stream_stats.h"
+
+namespace gr {
+namespace rtp {
+
+struct pcmstream {
+  uint32_t ssrc;            // RTP Sending Source ID
+  int type;                 // RTP payload type
+
+  struct sockaddr_storage sender;
+  char addr[NI_MAXHOST];    // RTP Sender IP address (numeric)
+  char port[NI_MAXSERV];    // RTP Sender source port
+
+  struct rtp_state rtp_state;
+};
+
+// One RTP PCM session (a single SSRC): tracks the sender and the RTP
+// timestamps, zero-fills gaps and decodes the payload to output items
+// according to its RTP payload type.
+// Shared by the single-stream and the multi-stream source blocks.
+template <class T>
+class session
+{
+private:
+    struct pcmstream pcmstream;
+    int channels;
+    bool quiet;
+    gr::logger_ptr logger;
+
+    // payload format, from the RTP payload type
+    int format_type;
+    payload_format format;
+    bool channels_warned;
+    // decoded samples that still need mixing or deinterleaving
+    typedef typename std::conditional<std::is_same<T, std::int16_t>::value,
+                                      std::int16_t, float>::type sample_type;
+    std::vector<sample_type> scratch;
+
+    // sequence number reordering (optional)
+    std::unique_ptr<jitter_buffer> jitter;
+    int jitter_latency; // ms a hole may hold up playout (0 = until the buffer is full)
+    uint16_t max_seq;   // highest sequence number received
+
+    // telemetry (on the heap: sessions get moved, atomics can't be)
+    std::unique_ptr<stream_stats> stats;
+    mutable event_log events; // gaps, out of order packets, truncated output and datagrams
+
+    // output that didn't fit in the output buffer, for the next calls
+    int carry_zeroes;                  // zero-fill items, before the samples
+    std::vector<std::vector<T>> carry; // decoded samples, per output
+    int carry_pos;                     // next item of carry to output
+    int carry_end;
+
+    // stream tags (optional)
+    gr::block *tag_block;
+    int tag_port;        // first output port of this session
+    bool tag_pending;    // new session or resync: tag the next packet
+    int samprate;        // from the stream status or the payload type (0 = unknown)
+    std::chrono::system_clock::time_point anchor_time; // time of the first frame after the last tag
+    uint64_t anchor_frames; // frames output since then
+    rtcp_receiver const *sender_clock; // RTCP sender reports (optional)
+    uint32_t sender_reports;           // taken into account so far
+
+    // radiod stream status (optional)
+    status_listener *status;
+    uint32_t status_updates; // taken into account so far
+    int stream_samprate;     // 0 = not reported
+    int stream_channels;
+    int stream_encoding;     // radiod output_encoding (0 = not reported)
+    double frequency;
+
+public:
+    // jitter_packets / jitter_ms: reorder packets by sequence number, holding
+    // up to jitter_packets packets, or a hole for up to jitter_ms (0 = off)
+    session(int channels,
+            bool quiet,
+            const gr::logger_ptr& logger,
+            int jitter_packets = 0,
+            int jitter_ms = 0);
+
+    // Forget the current session; the next packet starts a new one
+    void reset() { pcmstream.ssrc = 0; }
+
+    uint32_t get_ssrc() const { return pcmstream.ssrc; }
+
+    int get_channels() const { return channels; }
+
+    int get_bits_per_sample() const { return format.bits; }
+
+    int get_jitter_depth() const { return jitter ? jitter->depth() : 0; }
+    // Largest payload process() will be given (sizes the jitter buffer);
+    // call it before the first packet
+    void set_packet_size(int size);
+    uint64_t get_reordered() const { return stream_stats::get(stats->reordered); }
+    uint64_t get_late() const { return stream_stats::get(stats->late); }
+    uint64_t get_lost() const { return stream_stats::get(stats->lost); }
+
+    // Stream telemetry; safe to read from any thread while work() runs
+    stream_stats const& get_stats() const { return *stats; }
+
+    // Sample rate of the stream (0 = unknown) and its radio frequency
+    // (0 = unknown, from the radiod status only)
+    int get_samprate() const { return samprate; }
+    double get_frequency() const { return frequency; }
+
+    void check_out_channels(int channels) const { return; }
+
+    // Process one RTP packet (payload dp[size]) from sender, that arrived at
+    // arrival_ns (ns since the epoch; 0 = now)
+    // Output goes to outs[0..noutput_channels-1] starting at produced, which is updated
+    // Returns false, without using the packet, if it doesn't fit in the space left
+    // in a partially filled output buffer (or output carried over from a
+    // packet bigger than the whole buffer still doesn't fit)
+    bool process(rtp_info const *rtp,
+                 uint8_t const *dp,
+                 int size,
+                 struct sockaddr const *sender,
+                 T** outs,
+                 int noutput_items,
+                 int noutput_channels,
+                 int& produced,
+                 int64_t arrival_ns = 0);
+
+    // Tag the output with rx_time and rx_rate at the start of the session,
+    // at every resync and at every gap (with rtp_gap, the number of samples
+    // zero-filled); tags go to the outputs of block from port on
+    void set_tags(gr::block *block, int port) { tag_block = block; tag_port = port; }
+
+    // Take rx_time from the RTCP sender reports of the stream, when there are
+    // any, instead of the arrival time; every new report restarts the timeline
+    void set_sender_clock(rtcp_receiver const *clock) { sender_clock = clock; }
+
+    // Take the sample rate and the channel count from the radiod status of
+    // the stream, when the payload type doesn't say, and tag rx_freq with its
+    // frequency; every change of rate or frequency is tagged
+    void set_status(status_listener *listener) { status = listener; }
+
+    // Output what was carried over from the previous calls, play the packets
+    // held in the jitter buffer that are due by now, and report the events
+    // counted since the last report, if it is time to
+    void drain(T** outs, int noutput_items, int noutput_channels, int& produced);
+
+    // Report n datagrams the receiver dropped for being bigger than its buffers
+    void oversize(uint64_t n) { events.record(event_log::Oversize, n); }
+
+private:
+    void set_format(int type);
+    void update_status();
+    void restart(uint16_t seq);
+    void add_tags(int offset, int noutput_channels, uint64_t frames, int gap);
+    bool carrying() const { return carry_zeroes > 0 || carry_pos < carry_end; }
+    bool flush_carry(T** outs, int noutput_items, int noutput_channels, int& produced);
+    bool reorder(rtp_info const *rtp, uint8_t const *dp, int size, T** outs,
+                 int noutput_items, int noutput_channels, int& produced);
+    void account(rtp_info const *rtp, int size, int64_t arrival_ns);
+    bool release(T** outs, int noutput_items, int noutput_channels, int& produced);
+    bool release_head(T** outs, int noutput_items, int noutput_channels, int& produced);
+    bool play(rtp_info const *rtp, uint8_t const *dp, int size, T** outs,
+              int noutput_items, int noutput_channels, int& produced);
+    int get_output_items(int sampcount, int channels, int noutput_channels, int time_step) const {
+        return time_step + sampcount / channels;  // == sampcount for mono, sampcount/2 for stereo
+    }
+    int output_zeroes(int nzeroes, int channels, T** outs,
+                      int noutput_items, int noutput_channels,
+                      int offset = 0) const;
+    int output_samples(const void *dp, encoding enc, int sampcount, int channels,
+                       T** outs, int noutput_items, int noutput_channels,
+                       int offset = 0);
+};
+
+template <>
+void session<gr_complex>::check_out_channels(int channels) const;
+template <>
+int session<std::int16_t>::get_output_items(int sampcount, int channels, int noutput_channels, int time_step) const;
+
+} // namespace rtp
+} // namespace gr
+
+#endif /* INCLUDED_RTP_SESSION_H */
@@ -0,0 +1,316 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 Franco Venturi.
+ *
+ * based on:
+ * - the RTP output of radiod in ka9q-radio
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "sink_impl.h"
+#include <gnuradio/io_signature.h>
+
+#include <unistd.h>
+#include <cstring>
+#include <random>
+
+#include "convert.h"
+#include "mcast_join.h"
+#include "packet_arena.h"
+
+namespace gr {
+namespace rtp {
+
+// Config constants
+
+// While the socket buffer is full, work() waits this long at a time for room,
+// so it can be interrupted by Boost
+static int const send_timeout_ms = 100;
+
+template <typename T>
+typename sink<T>::sptr sink<T>::make(const std::string& mcast_address,
+                                     unsigned int ssrc,
+                                     int samp_rate,
+                                     int in_channels,
+                                     int out_channels,
+                                     int samples_per_packet,
+                                     int ttl,
+                                     int batch_size)
+{
+    return gnuradio::make_block_sptr<sink_impl<T>>(mcast_address,
+                                                   ssrc,
+                                                   samp_rate,
+                                                   in_channels,
+                                                   out_channels,
+                                                   samples_per_packet,
+                                                   ttl,
+                                                   batch_size);
+}
+
+template <typename T>
+sink_impl<T>::sink_impl(const std::string& mcast_address,
+                        unsigned int ssrc,
+                        int samp_rate,
+                        int in_channels,
+                        int out_channels,
+                        int samples_per_packet,
+                        int ttl,
+                        int batch_size)
+    : gr::sync_block("rtp_sink",
+                     gr::io_signature::make(in_channels, in_channels, sizeof(T)),
+                     gr::io_signature::make(0, 0, 0)),
+      mcast_fd(-1),
+      in_channels(in_channels),
+      out_channels(out_channels),
+      samples_per_packet(samples_per_packet),
+      items_per_frame(1),
+      ssrc(ssrc),
+      payload_type(pt_from_info(samp_rate, out_channels)),
+      marker(true),
+      batch_size(std::max(batch_size, 1)),
+      tx_pending(0),
+      tx_frames(0),
+      send_failing(false),
+      packets(0),
+      dropped(0)
+{
+    if (samp_rate <= 0) {
+        throw std::runtime_error("invalid sample rate");
+    }
+    if (!supports(in_channels, out_channels)) {
+        throw std::runtime_error("invalid number of input ports or RTP channels");
+    }
+    if (samprate_from_pt(payload_type) != samp_rate) {
+        this->d_logger->info("No RTP payload type for {} Hz - receivers will assume {} Hz",
+                             samp_rate, samprate_from_pt(payload_type));
+    }
+    if (in_channels == 1 && out_channels == 2 && sizeof(T) == sizeof(std::int16_t)) {
+        // Interleaved shorts: one frame is two items
+        items_per_frame = 2;
+        this->set_output_multiple(items_per_frame);
+    }
+
+    // Random SSRC (never 0: receivers treat it as no SSRC), sequence number
+    // and timestamp, as in RFC 3550
+    std::random_device random;
+    while (this->ssrc == 0) {
+        this->ssrc = random();
+    }
+    seq = random();
+    timestamp = random();
+
+    // Set up multicast output
+    mcast_target target;
+    mcast_fd = mcast_resolver::setup_output(mcast_address, ttl, this->d_logger, &target);
+    if (mcast_fd == -1) {
+        auto error_message = std::string("Can't set up output to \"") + mcast_address + "\"";
+        this->d_logger->error(error_message);
+        throw std::runtime_error(error_message);
+    }
+
+    // Packets as large as the interface takes in one piece
+    int const frame_size = out_channels * sizeof(std::int16_t);
+    int const max_frames = (packet_arena::payload_size_for(target.iface.empty() ?
+                                   Default_mcast_iface : target.iface.c_str()) -
+                            RTP_MIN_SIZE) / frame_size;
+    if (this->samples_per_packet <= 0) {
+        this->samples_per_packet = max_frames;
+    } else if (this->samples_per_packet > max_frames) {
+        this->d_logger->warn("{} samples per packet would need IP fragments - sending {}",
+                             this->samples_per_packet, max_frames);
+        this->samples_per_packet = max_frames;
+    }
+    tx = std::make_unique<tx_batch>(this->batch_size,
+                                    RTP_MIN_SIZE + this->samples_per_packet * frame_size);
+}
+
+template <typename T>
+sink_impl<T>::~sink_impl()
+{
+    if (mcast_fd != -1) {
+        close(mcast_fd);
+    }
+}
+
+template <typename T>
+bool sink_impl<T>::start()
+{
+    marker = true;
+    return true;
+}
+
+template <typename T>
+bool sink_impl<T>::stop()
+{
+    // Send what's left as a short packet
+    if (tx_frames > 0) {
+        finish_packet();
+    }
+    flush();
+    return true;
+}
+
+// Input port and RTP channel layouts:
+// complex: I/Q as stereo, or the real part as mono
+template <>
+bool sink_impl<gr_complex>::supports(int in_channels, int out_channels)
+{
+    return in_channels == 1 && (out_channels == 1 || out_channels == 2);
+}
+
+// float: mono, stereo, mono duplicated to stereo, or stereo downmixed to mono
+template <>
+bool sink_impl<float>::supports(int in_channels, int out_channels)
+{
+    return (in_channels == 1 || in_channels == 2) && (out_channels == 1 || out_channels == 2);
+}
+
+// short: mono, stereo, or interleaved stereo (I/Q) on one port
+template <>
+bool sink_impl<std::int16_t>::supports(int in_channels, int out_channels)
+{
+    return (in_channels == 1 && (out_channels == 1 || out_channels == 2)) ||
+           (in_channels == 2 && out_channels == 2);
+}
+
+// Encode nframes frames from the inputs, starting at item offset, into out
+template <>
+void sink_impl<gr_complex>::encode(gr_vector_const_void_star& input_items,
+                                   int offset,
+                                   void *out,
+                                   int nframes)
+{
+    auto in = reinterpret_cast<float const *>(
+        static_cast<gr_complex const *>(input_items[0]) + offset);
+    if (out_channels == 2) {
+        encode_f32_s16be(in, out, 2 * nframes);
+    } else {
+        encode_cf32_s16be_real(in, out, nframes);
+    }
+}
+
+template <>
+void sink_impl<float>::encode(gr_vector_const_void_star& input_items,
+                              int offset,
+                              void *out,
+                              int nframes)
+{
+    auto left = static_cast<float const *>(input_items[0]) + offset;
+    if (in_channels == 1) {
+        if (out_channels == 1) {
+            encode_f32_s16be(left, out, nframes);
+        } else {
+            encode_f32_s16be_dup(left, out, nframes);
+        }
+        return;
+    }
+    auto right = static_cast<float const *>(input_items[1]) + offset;
+    if (out_channels == 2) {
+        encode_f32_s16be_interleave(left, right, out, nframes);
+    } else {
+        encode_f32_s16be_downmix(left, right, out, nframes);
+    }
+}
+
+template <>
+void sink_impl<std::int16_t>::encode(gr_vector_const_void_star& input_items,
+                                     int offset,
+                                     void *out,
+                                     int nframes)
+{
+    auto left = static_cast<std::int16_t const *>(input_items[0]) + offset;
+    if (in_channels == 1) {
+        // mono, or already interleaved
+        encode_s16_s16be(left, out, nframes * out_channels);
+        return;
+    }
+    auto right = static_cast<std::int16_t const *>(input_items[1]) + offset;
+    encode_s16_s16be_interleave(left, right, out, nframes);
+}
+
+// The packet being filled is complete: put the RTP header in front of it
+template <typename T>
+void sink_impl<T>::finish_packet()
+{
+    struct rtp_header rtp;
+    memset(&rtp, 0, sizeof(rtp));
+    rtp.version = RTP_VERS;
+    rtp.type = payload_type;
+    rtp.seq = seq++;
+    rtp.timestamp = timestamp;
+    rtp.ssrc = ssrc;
+    rtp.marker = marker;
+    hton_rtp(tx->data(tx_pending), &rtp);
+    tx->set_len(tx_pending, RTP_MIN_SIZE + tx_frames * out_channels * sizeof(std::int16_t));
+    timestamp += tx_frames;
+    marker = false;
+    tx_pending++;
+    tx_frames = 0;
+}
+
+// Send the complete packets in the batch
+template <typename T>
+void sink_impl<T>::flush()
+{
+    int sent = 0;
+    while (sent < tx_pending) {
+        int const n = tx->send(mcast_fd, sent, tx_pending - sent, send_timeout_ms);
+        if (n > 0) {
+            sent += n;
+            packets += n;
+            send_failing = false;
+        } else if (n == 0) {
+            // Socket buffer still full: keep waiting, unless we're being stopped
+            boost::this_thread::interruption_point();
+        } else {
+            // Better to drop the packets than to stall the flowgraph
+            if (!send_failing) {
+                this->d_logger->warn("send failed: {}", strerror(errno));
+                send_failing = true;
+            }
+            dropped += tx_pending - sent;
+            break;
+        }
+    }
+    if (tx_frames > 0 && tx_pending > 0) {
+        // Move the packet being filled to the start of the batch
+        memcpy(tx->data(0) + RTP_MIN_SIZE, tx->data(tx_pending) + RTP_MIN_SIZE,
+               tx_frames * out_channels * sizeof(std::int16_t));
+    }
+    tx_pending = 0;
+}
+
+template <typename T>
+int sink_impl<T>::work(int noutput_items,
+                       gr_vector_const_void_star& input_items,
+                       gr_vector_void_star& output_items)
+{
+    int const frame_size = out_channels * sizeof(std::int16_t);
+    int consumed = 0;
+    while (consumed < noutput_items) {
+        int const nframes = std::min(samples_per_packet - tx_frames,
+                                     (noutput_items - consumed) / items_per_frame);
+        encode(input_items, consumed,
+               tx->data(tx_pending) + RTP_MIN_SIZE + tx_frames * frame_size, nframes);
+        tx_frames += nframes;
+        consumed += nframes * items_per_frame;
+        if (tx_frames == samples_per_packet) {
+            finish_packet();
+            if (tx_pending == batch_size) {
+                flush();
+            }
+        }
+    }
+    // Don't hold complete packets back until the next call
+    flush();
+
+    // Tell runtime system how many input items we consumed.
+    return noutput_items;
+}
+
+template class sink<gr_complex>;
+template class sink<float>;
+template class sink<std::int16_t>;
+} /* namespace rtp */
+} /* namespace gr */
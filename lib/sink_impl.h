@@ -0,0 +1,92 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 Franco Venturi.
+ *
+ * based on:
+ * - the RTP output of radiod in ka9q-radio
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_RTP_SINK_IMPL_H
+#define INCLUDED_RTP_SINK_IMPL_H
+
+#include <gnuradio/rtp/sink.h>
+
+#include <atomic>
+#include <memory>
+
+#include "multicast.h"
+#include "tx_batch.h"
+
+namespace gr {
+namespace rtp {
+
+template <class T>
+class sink_impl : public sink<T>
+{
+private:
+    int mcast_fd;
+    int in_channels;
+    int out_channels;
+    int samples_per_packet; // frames
+    int items_per_frame;    // 2 for interleaved shorts, 1 otherwise
+
+    // RTP sender state
+    uint32_t ssrc;
+    int payload_type;
+    uint16_t seq;
+    uint32_t timestamp;
+    bool marker; // next packet starts the stream
+
+    // sendmmsg() batch
+    int batch_size;
+    std::unique_ptr<tx_batch> tx;
+    int tx_pending; // complete packets in the batch
+    int tx_frames;  // frames in the packet being filled
+    bool send_failing;
+
+    std::atomic<uint64_t> packets;
+    std::atomic<uint64_t> dropped;
+
+public:
+    sink_impl(const std::string& mcast_address,
+              unsigned int ssrc,
+              int samp_rate,
+              int in_channels=1,
+              int out_channels=1,
+              int samples_per_packet=0,
+              int ttl=1,
+              int batch_size=16);
+    ~sink_impl();
+
+    bool start() override;
+    bool stop() override;
+
+    unsigned int get_ssrc() const override { return ssrc; };
+
+    int get_payload_type() const override { return payload_type; };
+
+    int get_samples_per_packet() const override { return samples_per_packet; };
+
+    int get_batch_size() const override { return batch_size; };
+
+    uint64_t get_packets() const override { return packets; };
+
+    uint64_t get_dropped() const override { return dropped; };
+
+    int work(int noutput_items,
+             gr_vector_const_void_star& input_items,
+             gr_vector_void_star& output_items);
+
+private:
+    void encode(gr_vector_const_void_star& input_items, int offset, void *out, int nframes);
+    void finish_packet();
+    void flush();
+    static bool supports(int in_channels, int out_channels);
+};
+
+} // namespace rtp
+} // namespace gr
+
+#endif /* INCLUDED_RTP_SINK_IMPL_H */
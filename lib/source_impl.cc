@@ -12,31 +12,65 @@
 
 #include "source_impl.h"
 #include <gnuradio/io_signature.h>
+#ifdef GR_CTRLPORT
+#include <gnuradio/rpcregisterhelpers.h>
+#endif
+
+#include <unistd.h>
 
 namespace gr {
 namespace rtp {
 
 // Config constants
-static int const Bufsize = 9000; // allow for jumbograms
 
+static int const Default_ring_depth = 256; // packets, when sharing the socket
+
+// When the scheduler thread reads the socket itself (ring depth 0), it must
+// come back regularly so it can be interrupted by Boost; the receiver threads
+// and ring waits don't need a timeout
 static struct timeval udp_timeout = {0, 100000};   // set timeout to 0.1s
+static int const uring_timeout_ms = 100;           // same for io_uring
+static int const ring_timeout_ms = 100;            // while the jitter buffer holds packets
 
-// internal functions defined below
-static void init(struct pcmstream *pc, struct rtp_header const *rtp,
-                 struct sockaddr const *sender);
+static const pmt::pmt_t Status_port = pmt::mp("status");
+static const pmt::pmt_t Stats_port = pmt::mp("stats");
 
 template <typename T>
 typename source<T>::sptr source<T>::make(const std::string& mcast_address,
                                          unsigned int ssrc,
                                          int in_channels,
                                          int out_channels,
-                                         bool quiet)
+                                         bool quiet,
+                                         int batch_size,
+                                         int ring_depth,
+                                         bool shared_socket,
+                                         int jitter_packets,
+                                         int jitter_ms,
+                                         bool latency_stats,
+                                         bool async_join,
+                                         bool zero_copy,
+                                         bool io_uring,
+                                         bool rtcp,
+                                         const std::string& status_address,
+                                         int stats_interval)
 {
     return gnuradio::make_block_sptr<source_impl<T>>(mcast_address,
                                                      ssrc,
                                                      in_channels,
                                                      out_channels,
-                                                     quiet);
+                                                     quiet,
+                                                     batch_size,
+                                                     ring_depth,
+                                                     shared_socket,
+                                                     jitter_packets,
+                                                     jitter_ms,
+                                                     latency_stats,
+                                                     async_join,
+                                                     zero_copy,
+                                                     io_uring,
+                                                     rtcp,
+                                                     status_address,
+                                                     stats_interval);
 }
 
 template <typename T>
@@ -44,422 +78,526 @@ source_impl<T>::source_impl(const std::string& mcast_address,
                             unsigned int ssrc,
                             int in_channels,
                             int out_channels,
-                            bool quiet)
+                            bool quiet,
+                            int batch_size,
+                            int ring_depth,
+                            bool shared_socket,
+                            int jitter_packets,
+                            int jitter_ms,
+                            bool latency_stats,
+                            bool async_join,
+                            bool zero_copy,
+                            bool io_uring,
+                            bool rtcp,
+                            const std::string& status_address,
+                            int stats_interval)
     : gr::sync_block("rtp_source",
                      gr::io_signature::make(0, 0, 0),
                      gr::io_signature::make(out_channels, out_channels, sizeof(T))),
       mcast_fd(-1),
-      pcmstream{}, // Init with zeros
+      pcm_session(in_channels, quiet, this->d_logger, jitter_packets, jitter_ms),
       ssrc(ssrc),
-      channels(in_channels),
-      quiet(quiet)
+      batch_size(std::max(batch_size, 1)),
+      rx(this->batch_size, 0, latency_stats),
+      rx_count(0),
+      rx_next(0),
+      rx_stop(false),
+      rx_running(false),
+      truncations_reported(0),
+      latency_stats(latency_stats),
+      pkt_kernel_ns(0),
+      pkt_recv_ns(0),
+      stats_interval(std::max(stats_interval, 0))
 {
-    check_out_channels(out_channels);
+    pcm_session.check_out_channels(out_channels);
+    pcm_session.set_tags(this, 0);
+    if (zero_copy && (shared_socket || ring_depth > 0 || async_join)) {
+        this->d_logger->warn("Zero copy needs ring depth 0, no shared socket and no "
+                             "background join - using the UDP socket");
+        zero_copy = false;
+    }
+    if (io_uring && (async_join || zero_copy || (ring_depth > 0 && !shared_socket))) {
+        this->d_logger->warn("io_uring needs ring depth 0 or a shared socket, no zero copy and "
+                             "no background join - using recvmmsg()");
+        io_uring = false;
+    }
+    if (rtcp) {
+        // Its own sockets and thread, whatever reads the RTP stream
+        this->rtcp = std::make_unique<rtcp_receiver>(mcast_address, this->d_logger);
+        pcm_session.set_sender_clock(this->rtcp.get());
+    }
+    this->message_port_register_out(Status_port);
+    this->message_port_register_out(Stats_port);
+    if (!status_address.empty()) {
+        stream_status = std::make_unique<status_listener>(
+            status_address, this->d_logger,
+            [this](const channel_status& status) { publish_status(status); });
+        pcm_session.set_status(stream_status.get());
+    }
+    if (shared_socket) {
+        // One socket per multicast address, demultiplexed by SSRC into our ring
+        try {
+            demux = mcast_demux::get(mcast_address, this->batch_size, async_join, io_uring);
+        } catch (const std::runtime_error& e) {
+            this->d_logger->error(e.what());
+            throw;
+        }
+        ring = std::make_shared<packet_ring>(ring_depth > 0 ? ring_depth : Default_ring_depth,
+                                             demux->slot_size());
+        pcm_session.set_packet_size(demux->slot_size());
+        if (latency_stats) {
+            demux->enable_timestamps();
+        }
+        return;
+    }
+
+    auto configure = [latency_stats, ring_depth](int fd) {
+        if (ring_depth == 0) {
+            // set UDP socket timeout so it can be interrupted by Boost
+            setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, (char*)&udp_timeout, sizeof(udp_timeout));
+        }
+        if (latency_stats) {
+            // kernel receive timestamps
+            int const on = 1;
+            setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on));
+        }
+    };
+
     // Set up multicast input
-    mcast_fd = setup_mcast_in(mcast_address.c_str(), NULL, 0);
+    mcast_target target;
+    if (async_join) {
+        // Read from a placeholder until the group is joined in the background
+        mcast_fd = mcast_joiner::placeholder();
+    } else {
+        mcast_fd = mcast_resolver::setup_input(mcast_address, this->d_logger, &target);
+    }
     if (mcast_fd == -1) {
         auto error_message = std::string("Can't set up input from \"") + mcast_address + "\"";
         this->d_logger->error(error_message);
         throw std::runtime_error(error_message);
     }
-    // set UDP socket timeout so it can be interrupted by Boost
-    setsockopt(mcast_fd, SOL_SOCKET, SO_RCVTIMEO, (char*)&udp_timeout, sizeof(udp_timeout));
+    configure(mcast_fd);
     //this->set_min_noutput_items(1200);
+    if (async_join) {
+        // wake up the receiver thread so it polls the joined socket
+        joiner = std::make_unique<mcast_joiner>(mcast_address, mcast_fd, configure,
+                                                this->d_logger, [this] { rx_wake.notify(); });
+    }
+    if (zero_copy) {
+        // mcast_fd just keeps the group joined from now on
+        packet_rx = tpacket_rx::open(target, mcast_fd, this->d_logger);
+    }
+    if (io_uring) {
+        uring = uring_rx::open(mcast_fd, this->batch_size, latency_stats, this->d_logger);
+    }
+
+    // Packet buffers for what the interface can deliver in one piece
+    // (with the join in the background, the interface isn't known yet;
+    // io_uring has buffers of its own, with room for jumbograms)
+    int const slot_size = async_join ? Packet_slot_size
+                                     : packet_arena::slot_size_for(target.iface.empty() ?
+                                           Default_mcast_iface : target.iface.c_str());
+    pcm_session.set_packet_size(uring ? uring_rx::Payload_size : slot_size);
+    if (ring_depth > 0) {
+        // The receiver thread reads straight into the ring slots;
+        // one scratch buffer is enough to discard datagrams on overrun
+        ring = std::make_shared<packet_ring>(ring_depth, slot_size);
+        overrun_buffer.resize(slot_size);
+    } else if (!packet_rx && !uring) {
+        rx.allocate(slot_size);
+    }
 }
 
 template <typename T>
-source_impl<T>::~source_impl() {}
+source_impl<T>::~source_impl()
+{
+    stream_status.reset(); // no more status messages from here on
+    joiner.reset(); // before its socket goes away
+    uring.reset();
+    if (mcast_fd != -1) {
+        close(mcast_fd);
+    }
+}
 
 template <typename T>
-int source_impl<T>::work(int noutput_items,
-                         gr_vector_const_void_star& input_items,
-                         gr_vector_void_star& output_items)
+bool source_impl<T>::start()
 {
-    auto outs = reinterpret_cast<T**>(&output_items[0]);
+    next_stats = std::chrono::steady_clock::now() + stats_interval;
+    if (demux) {
+        demux->subscribe(ssrc, ring);
+        rx_running = true;
+    } else if (ring) {
+        rx_stop = false;
+        rx_thread = gr::thread::thread([this] { receiver(); });
+        rx_running = true;
+    }
+    return true;
+}
 
-    // audio input thread
-    // Receive audio multicasts, multiplex into sessions, send to output
-    // What do we do if we get different streams?? think about this
-    struct sockaddr sender;
-    socklen_t socksize = sizeof(sender);
-    uint8_t buffer[Bufsize];
-    // Gets all packets to multicast destination address, regardless of sender IP, sender port, dest port, ssrc
-    int size;
-    while (true) {
-        boost::this_thread::interruption_point();
-        size = recvfrom(mcast_fd, buffer, sizeof(buffer), 0, &sender, &socksize);
+template <typename T>
+bool source_impl<T>::stop()
+{
+    if (demux) {
+        demux->unsubscribe(ring);
+    } else if (rx_thread.joinable()) {
+        rx_stop = true;
+        rx_wake.notify();
+        rx_thread.join();
+    }
+    rx_running = false;
+    return true;
+}
 
-        if (size == -1) {
-            perror("recvmsg");
-            return 0;
-        }
-        if(size < RTP_MIN_SIZE) {
-            continue; // Too small to be valid RTP
+// Receiver thread: move datagrams from the socket into the ring
+// so a stalled downstream doesn't back up into the kernel socket buffer
+// It sleeps in rx_wake.wait() while there's nothing to read, until data
+// arrives or stop() wakes it up
+template <typename T>
+void source_impl<T>::receiver()
+{
+    while (!rx_stop) {
+        int const nfree = ring->writable();
+        if (nfree == 0) {
+            // Ring full: read and discard, so the loss is counted
+            if (recv(mcast_fd, overrun_buffer.data(), overrun_buffer.size(), MSG_DONTWAIT) >= 0) {
+                ring->overrun();
+            } else {
+                rx_wake.wait(mcast_fd);
+            }
+            continue;
         }
-
-        struct rtp_header rtp;
-        auto dp = static_cast<uint8_t const *>(ntoh_rtp(&rtp, buffer));
-
-        size -= dp - buffer;
-        if (rtp.pad) {
-            // Remove padding
-            size -= dp[size-1];
-            rtp.pad = 0;
+        int const nslots = std::min(nfree, batch_size);
+        for (int i = 0; i < nslots; i++) {
+            packet_slot *slot = ring->write_slot(i);
+            rx.bind(i, slot->data, ring->slot_size(), &slot->sender);
         }
-        if (size <= 0) {
+        int const n = rx.receive(mcast_fd, nslots, false);
+        if (n == 0) {
+            rx_wake.wait(mcast_fd);
             continue;
         }
-
-        if (rtp.ssrc == 0 || (ssrc != 0 && rtp.ssrc != ssrc)) {
-           continue; // Ignore unwanted or invalid SSRCs
+        for (int i = 0; i < n; i++) {
+            packet_slot *slot = ring->write_slot(i);
+            slot->len = rx.len(i);
+            // 0 without latency stats: the arrival time is taken when it's processed
+            slot->kernel_ns = rx.kernel_ns(i);
+            slot->recv_ns = rx.recv_ns();
         }
+        ring->publish(n);
+    }
+}
 
-        if (pcmstream.ssrc == 0) {
-            // First packet on stream, initialize
-            init(&pcmstream, &rtp, &sender);
-
-            if (!quiet) {
-                this->d_logger->info("New session from {}@{}:{}",
-                                     pcmstream.ssrc,
-                                     pcmstream.addr,
-                                     pcmstream.port);
+// Return the next datagram to process, from the ring or from the recvmmsg() batch
+// When wait is true, block until one is available
+// Returns false if there is none
+template <typename T>
+bool source_impl<T>::next_packet(bool wait,
+                                 uint8_t const **data,
+                                 int *size,
+                                 struct sockaddr const **sender)
+{
+    if (ring) {
+        packet_slot *slot = ring->read_slot();
+        if (slot == NULL) {
+            // Sleep until a datagram arrives (Boost interrupts the wait on
+            // shutdown), unless held back packets may be due before then,
+            // or the next stats message is (the other inputs time out anyway)
+            int timeout_ms = pcm_session.get_jitter_depth() > 0 ? ring_timeout_ms : -1;
+            if (stats_interval.count() > 0) {
+                auto const left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                      next_stats - std::chrono::steady_clock::now())
+                                      .count() + 1;
+                timeout_ms = left <= 0 ? 0
+                             : timeout_ms < 0 ? left
+                                              : std::min<int64_t>(timeout_ms, left);
             }
-        } else if (rtp.ssrc != pcmstream.ssrc) {
-            continue; // unwanted SSRC, ignore
+            if (!wait || !ring->wait(timeout_ms)) {
+                return false;
+            }
+            slot = ring->read_slot();
         }
+        *data = slot->data;
+        *size = slot->len;
+        *sender = reinterpret_cast<struct sockaddr const *>(&slot->sender);
+        pkt_kernel_ns = slot->kernel_ns;
+        pkt_recv_ns = slot->recv_ns;
+        return true;
+    }
 
-        if (!address_match(&sender, &pcmstream.sender) || getportnumber(&pcmstream.sender) != getportnumber(&sender)) {
-            // Source changed, the sender restarted
-            init(&pcmstream, &rtp, &sender);
-            if (!quiet) {
-                this->d_logger->info("Session restart from {}@{}:{}",
-                                     pcmstream.ssrc,
-                                     pcmstream.addr,
-                                     pcmstream.port);
+    if (packet_rx) {
+        if (rx_next == rx_count) {
+            // Block exhausted: give it back and take the next one
+            rx_next = 0;
+            rx_count = packet_rx->receive(wait);
+            if (rx_count == 0) {
+                return false;
             }
         }
-        if (rtp.marker) {
-            pcmstream.rtp_state.timestamp = rtp.timestamp;      // Resynch
-        }
+        *data = packet_rx->data(rx_next);
+        *size = packet_rx->len(rx_next);
+        *sender = packet_rx->sender(rx_next);
+        pkt_kernel_ns = packet_rx->kernel_ns(rx_next);
+        pkt_recv_ns = packet_rx->recv_ns();
+        return true;
+    }
 
-        int const sampcount = size / sizeof(int16_t); // # of 16-bit samples, regardless of mono or stereo
-        int const framecount = sampcount / channels; // == sampcount for mono, sampcount/2 for stereo
-        // fv
-        //this->d_logger->info("noutput_items={} noutput_channels={} sampcount={} framecount={}", noutput_items, output_items.size(), sampcount, framecount);
-        int offset = 0;
-
-        int const time_step = rtp.timestamp - pcmstream.rtp_state.timestamp;
-        if (time_step < 0) {
-            // Old dupe
-            pcmstream.rtp_state.dupes++;
-            this->d_logger->info("Out of order samples - {} received after {}", rtp.timestamp, pcmstream.rtp_state.timestamp);
-            continue;
-        } else if (time_step > 0) {
-            pcmstream.rtp_state.drops++;
-            this->d_logger->info("Dropped {} samples - from {} to {}", time_step, pcmstream.rtp_state.timestamp, rtp.timestamp);
-            int const nexpected_output_items = get_output_items(sampcount, channels, output_items.size(), time_step);
-            if (nexpected_output_items <= noutput_items) {  // Arbitrary threshold - clean this up!
-                offset = output_zeroes(time_step, channels, outs,
-                                       noutput_items, output_items.size());
+    if (uring) {
+        if (rx_next == rx_count) {
+            // Batch exhausted: give its buffers back and take what has arrived since
+            rx_next = 0;
+            rx_count = uring->receive(wait ? uring_timeout_ms : 0);
+            if (rx_count == 0) {
+                return false;
             }
-            // Resync
-            pcmstream.rtp_state.timestamp = rtp.timestamp; // Bring up to date?
         }
-        pcmstream.rtp_state.bytes += size;
-
-        noutput_items = output_samples(dp, size, channels, outs, noutput_items,
-                                       output_items.size(), offset);
-
-        pcmstream.rtp_state.timestamp += framecount;
-        pcmstream.rtp_state.seq = rtp.seq + 1;
+        *data = uring->data(rx_next);
+        *size = uring->len(rx_next);
+        *sender = uring->sender(rx_next);
+        if (latency_stats) {
+            pkt_kernel_ns = uring->kernel_ns(rx_next);
+            pkt_recv_ns = uring->recv_ns();
+        }
+        return true;
+    }
 
-        // Tell runtime system how many output items we produced.
-        return noutput_items;
+    if (rx_next == rx_count) {
+        // Batch exhausted
+        rx_next = 0;
+        rx_count = rx.receive(mcast_fd, rx.size(), wait);
+        if (rx_count == 0) {
+            return false;
+        }
+    }
+    *data = rx.data(rx_next);
+    *size = rx.len(rx_next);
+    *sender = rx.sender(rx_next);
+    if (latency_stats) {
+        pkt_kernel_ns = rx.kernel_ns(rx_next);
+        pkt_recv_ns = rx.recv_ns();
     }
+    return true;
 }
 
-template<>
-void source_impl<gr_complex>::check_out_channels(int channels) const
+// Done with the datagram returned by next_packet()
+template <typename T>
+void source_impl<T>::consume_packet()
 {
-    if (channels > 1) {
-        throw std::runtime_error("gr_complex requires only 1 output");
+    if (ring) {
+        ring->release();
+    } else {
+        rx_next++;
     }
 }
 
-template<>
-int source_impl<std::int16_t>::get_output_items(int sampcount, int channels, int noutput_channels, int time_step) const
+// Record the latencies of the packet just processed
+template <typename T>
+void source_impl<T>::record_latency()
 {
-    if (channels == 2 && noutput_channels == 1) {
-        return time_step * channels + sampcount;  // interleaved short case
-    } else {
-        return time_step + sampcount / channels;  // == sampcount for mono, sampcount/2 for stereo
+    if (pkt_recv_ns == 0) {
+        return;
     }
+    if (pkt_kernel_ns != 0) {
+        kernel_latency.record(pkt_recv_ns - pkt_kernel_ns);
+    }
+    output_latency.record(rx_batch::now_ns() - pkt_recv_ns);
 }
 
-template <>
-int source_impl<gr_complex>::output_zeroes(int nzeroes,
-                                           int channels,
-                                           gr_complex** outs,
-                                           int noutput_items,
-                                           int noutput_channels,
-                                           int offset) const
+// Status message for the stream: a dict of ssrc, freq, samp_rate and
+// channels (0 when radiod doesn't say); called from the listener thread
+template <typename T>
+void source_impl<T>::publish_status(const channel_status& status)
 {
-    auto out = outs[0];
-
-    if (offset + nzeroes > noutput_items) {
-        this->d_logger->warn("work buffer not large enough - dropping zeroes - buffer size={} nzeroes={} offset={}", noutput_items, nzeroes, offset);
-        nzeroes = noutput_items - offset;
-    }
+    pmt::pmt_t msg = pmt::make_dict();
+    msg = pmt::dict_add(msg, pmt::mp("ssrc"), pmt::from_uint64(status.ssrc));
+    msg = pmt::dict_add(msg, pmt::mp("freq"), pmt::from_double(status.frequency));
+    msg = pmt::dict_add(msg, pmt::mp("samp_rate"), pmt::from_long(status.samprate));
+    msg = pmt::dict_add(msg, pmt::mp("channels"), pmt::from_long(status.channels));
+    this->message_port_pub(Status_port, msg);
+}
 
-    std::fill_n(out + offset, nzeroes, 0);
-    return offset + nzeroes;
+// Stats message: a dict of the stream counters (see the getters)
+template <typename T>
+void source_impl<T>::publish_stats()
+{
+    stream_stats const& stats = pcm_session.get_stats();
+    pmt::pmt_t msg = pmt::make_dict();
+    auto add = [&msg](char const *key, pmt::pmt_t value) {
+        msg = pmt::dict_add(msg, pmt::mp(key), value);
+    };
+    add("ssrc", pmt::from_uint64(pcm_session.get_ssrc()));
+    add("packets", pmt::from_uint64(stream_stats::get(stats.packets)));
+    add("bytes", pmt::from_uint64(stream_stats::get(stats.bytes)));
+    add("drops", pmt::from_uint64(stream_stats::get(stats.drops)));
+    add("dupes", pmt::from_uint64(stream_stats::get(stats.dupes)));
+    add("reordered", pmt::from_uint64(stream_stats::get(stats.reordered)));
+    add("late", pmt::from_uint64(stream_stats::get(stats.late)));
+    add("lost", pmt::from_uint64(stream_stats::get(stats.lost)));
+    add("zero_filled", pmt::from_uint64(stream_stats::get(stats.zero_filled)));
+    add("truncated", pmt::from_uint64(get_truncated()));
+    add("reorder_depth", pmt::from_long(stats.reorder_depth.load(std::memory_order_relaxed)));
+    add("jitter_ms", pmt::from_double(stats.jitter.ms()));
+    this->message_port_pub(Stats_port, msg);
 }
 
-template <>
-int source_impl<float>::output_zeroes(int nzeroes,
-                                      int channels,
-                                      float** outs,
-                                      int noutput_items,
-                                      int noutput_channels,
-                                      int offset) const
+// p50, p99 and p99.9 in microseconds
+template <typename T>
+std::vector<float> source_impl<T>::percentiles(const latency_histogram& h)
 {
-    if (offset + nzeroes > noutput_items) {
-        this->d_logger->warn("work buffer not large enough - dropping zeroes - buffer size={} nzeroes={} offset={}", noutput_items, nzeroes, offset);
-        nzeroes = noutput_items - offset;
-    }
-    if (noutput_channels == 1) {
-        auto out = outs[0];
-        std::fill_n(out + offset, nzeroes, 0);
-    } else if (noutput_channels == 2) {
-        auto out_left = outs[0];
-        auto out_right = outs[1];
-        std::fill_n(out_left + offset, nzeroes, 0);
-        std::fill_n(out_right + offset, nzeroes, 0);
-    } else {
-        nzeroes = 0;
-    }
-    return offset + nzeroes;
+    return { float(h.quantile(0.5) / 1e3),
+             float(h.quantile(0.99) / 1e3),
+             float(h.quantile(0.999) / 1e3) };
 }
 
-template <>
-int source_impl<std::int16_t>::output_zeroes(int nzeroes,
-                                             int channels,
-                                             std::int16_t** outs,
-                                             int noutput_items,
-                                             int noutput_channels,
-                                             int offset) const
+template <typename T>
+void source_impl<T>::setup_rpc()
 {
-    // interleaved short case
-    if (channels == 2 && noutput_channels == 1) {
-        nzeroes *= 2;
-    }
-    if (offset + nzeroes > noutput_items) {
-        this->d_logger->warn("work buffer not large enough - dropping zeroes - buffer size={} nzeroes={} offset={}", noutput_items, nzeroes, offset);
-        nzeroes = noutput_items - offset;
-        // interleaved short case - make sure nzeroes is even
-        if (channels == 2 && noutput_channels == 1) {
-            nzeroes -= nzeroes % 2;
-        }
-    }
-    if (noutput_channels == 1) {
-        auto out = outs[0];
-        std::fill_n(out + offset, nzeroes, 0);
-    } else if (noutput_channels == 2) {
-        auto out_left = outs[0];
-        auto out_right = outs[1];
-        std::fill_n(out_left + offset, nzeroes, 0);
-        std::fill_n(out_right + offset, nzeroes, 0);
-    } else {
-        nzeroes = 0;
+#ifdef GR_CTRLPORT
+    this->add_rpc_variable(rpcbasic_sptr(new rpcbasic_register_get<source<T>, std::vector<float>>(
+        this->alias(),
+        "kernel_latency",
+        &source<T>::get_kernel_latency,
+        pmt::mp(0.0f),
+        pmt::mp(1e6f),
+        pmt::mp(0.0f),
+        "us",
+        "Kernel to socket read latency p50/p99/p99.9",
+        RPC_PRIVLVL_MIN,
+        DISPTIME)));
+    this->add_rpc_variable(rpcbasic_sptr(new rpcbasic_register_get<source<T>, std::vector<float>>(
+        this->alias(),
+        "output_latency",
+        &source<T>::get_output_latency,
+        pmt::mp(0.0f),
+        pmt::mp(1e6f),
+        pmt::mp(0.0f),
+        "us",
+        "Socket read to output buffer latency p50/p99/p99.9",
+        RPC_PRIVLVL_MIN,
+        DISPTIME)));
+
+    // Stream counters
+    struct counter {
+        char const *name;
+        uint64_t (source<T>::*get)() const;
+        char const *units;
+        char const *description;
+    };
+    static counter const counters[] = {
+        { "packets", &source<T>::get_packets, "packets", "Packets received" },
+        { "bytes", &source<T>::get_bytes, "bytes", "Payload bytes received" },
+        { "drops", &source<T>::get_drops, "packets", "Packets missing from the sequence" },
+        { "dupes", &source<T>::get_dupes, "packets", "Duplicate or too old packets" },
+        { "reordered", &source<T>::get_reordered, "packets", "Packets put back in sequence" },
+        { "late", &source<T>::get_late, "packets", "Packets past their turn" },
+        { "lost", &source<T>::get_lost, "packets", "Packets given up on" },
+        { "zero_filled", &source<T>::get_zero_filled, "samples", "Zero samples output" },
+        { "truncated", &source<T>::get_truncated, "packets", "Datagrams too big for the buffers" },
+    };
+    for (auto const& c : counters) {
+        this->add_rpc_variable(rpcbasic_sptr(new rpcbasic_register_get<source<T>, uint64_t>(
+            this->alias(),
+            c.name,
+            c.get,
+            pmt::from_uint64(0),
+            pmt::from_uint64(UINT64_MAX),
+            pmt::from_uint64(0),
+            c.units,
+            c.description,
+            RPC_PRIVLVL_MIN,
+            DISPNULL)));
     }
-    return offset + nzeroes;
+    this->add_rpc_variable(rpcbasic_sptr(new rpcbasic_register_get<source<T>, int>(
+        this->alias(),
+        "reorder_depth",
+        &source<T>::get_reorder_depth,
+        pmt::mp(0),
+        pmt::mp(65535),
+        pmt::mp(0),
+        "packets",
+        "Reorder depth",
+        RPC_PRIVLVL_MIN,
+        DISPNULL)));
+    this->add_rpc_variable(rpcbasic_sptr(new rpcbasic_register_get<source<T>, float>(
+        this->alias(),
+        "interarrival_jitter",
+        &source<T>::get_interarrival_jitter,
+        pmt::mp(0.0f),
+        pmt::mp(1e3f),
+        pmt::mp(0.0f),
+        "ms",
+        "Interarrival jitter (RFC 3550)",
+        RPC_PRIVLVL_MIN,
+        DISPTIME)));
+#endif /* GR_CTRLPORT */
 }
 
-template <>
-int source_impl<gr_complex>::output_samples(const void *dp,
-                                            int size,
-                                            int channels,
-                                            gr_complex** outs,
-                                            int noutput_items,
-                                            int noutput_channels,
-                                            int offset) const
+template <typename T>
+int source_impl<T>::work(int noutput_items,
+                         gr_vector_const_void_star& input_items,
+                         gr_vector_void_star& output_items)
 {
-    auto out = outs[0];
-
-    int samples = size / (sizeof(int16_t) * channels);
-    if (offset + samples > noutput_items) {
-        this->d_logger->warn("work buffer not large enough - dropping samples - buffer size={} samples={} offset={}", noutput_items, samples, offset);
-        samples = noutput_items - offset;
-    }
+    auto outs = reinterpret_cast<T**>(&output_items[0]);
 
-    auto sdp = static_cast<const int16_t *>(dp);
-    if (channels == 1) {
-        for (int i = offset; i < offset + samples; i++) {
-            // Swap sample to host order
-            int16_t d = ntohs(*sdp++);
-            out[i].real(static_cast<float>(d) / 32767.0f);
-            out[i].imag(0.0);
-        }
-    } else if (channels == 2) {
-        for (int i = offset; i < offset + samples; i++) {
-            // Swap sample to host order
-            int16_t left = ntohs(*sdp++);
-            int16_t right = ntohs(*sdp++);
-            out[i].real(static_cast<float>(left) / 32767.0f);
-            out[i].imag(static_cast<float>(right) / 32767.0f);
+    // audio input thread
+    // Receive audio multicasts, multiplex into sessions, send to output
+    // What do we do if we get different streams?? think about this
+    // Gets all packets to multicast destination address, regardless of sender IP, sender port, dest port, ssrc
+    // First what was carried over from the previous call (a packet bigger
+    // than the output buffer) and the held back packets that are due by now,
+    // then as many queued datagrams as fit in the output buffer
+    int produced = 0;
+    pcm_session.drain(outs, noutput_items, output_items.size(), produced);
+    while (produced < noutput_items) {
+        boost::this_thread::interruption_point();
+        // Only block if we have nothing to return yet
+        uint8_t const *buffer;
+        int size;
+        struct sockaddr const *sender;
+        if (!next_packet(produced == 0, &buffer, &size, &sender)) {
+            break;
         }
-    } else {
-        samples = 0;
-    }
 
-    return offset + samples;
-}
-
-template <>
-int source_impl<float>::output_samples(const void *dp,
-                                       int size,
-                                       int channels,
-                                       float** outs,
-                                       int noutput_items,
-                                       int noutput_channels,
-                                       int offset) const
-{
-    int samples = size / (sizeof(int16_t) * channels);
-    if (offset + samples > noutput_items) {
-        this->d_logger->warn("work buffer not large enough - dropping samples - buffer size={} samples={} offset={}", noutput_items, samples, offset);
-        samples = noutput_items - offset;
-    }
+        rtp_info rtp;
+        uint8_t const *dp;
+        size = parse_rtp(buffer, size, ssrc, rtp, &dp);
+        if (size <= 0) {
+            consume_packet();
+            continue; // Not valid RTP, empty, or an unwanted SSRC
+        }
 
-    auto sdp = static_cast<const int16_t *>(dp);
-    if (noutput_channels == 1) {
-        auto out = outs[0];
-        if (channels == 1) {
-            for (int i = offset; i < offset + samples; i++) {
-                // Swap sample to host order
-                int16_t d = ntohs(*sdp++);
-                out[i] = static_cast<float>(d) / 32767.0f;
-            }
-        } else if (channels == 2) {
-            // Downmix to mono
-            for (int i = offset; i < offset + samples; i++) {
-                // Swap sample to host order
-                int16_t left = ntohs(*sdp++);
-                int16_t right = ntohs(*sdp++);
-                float leftf = static_cast<float>(left) / 32767.0f;
-                float rightf = static_cast<float>(right) / 32767.0f;
-                out[i] = (leftf + rightf) / 2.0;
-            }
-        } else {
-            samples = 0;
+        int64_t const arrival_ns = pkt_kernel_ns != 0 ? pkt_kernel_ns : rx_batch::now_ns();
+        if (!pcm_session.process(&rtp, dp, size, sender, outs, noutput_items,
+                                 output_items.size(), produced, arrival_ns)) {
+            break; // Doesn't fit; keep it for the next call
         }
-    } else if (noutput_channels == 2) {
-        auto out_left = outs[0];
-        auto out_right = outs[1];
-        if (channels == 1) {
-            // Expand to pseudo-stereo
-            for (int i = offset; i < offset + samples; i++) {
-                // Swap sample to host order
-                int16_t d = ntohs(*sdp++);
-                float df  = static_cast<float>(d) / 32767.0f;
-                out_left[i] = df;
-                out_right[i] = df;
-            }
-        } else if (channels == 2) {
-            for (int i = offset; i < offset + samples; i++) {
-                // Swap sample to host order
-                int16_t left = ntohs(*sdp++);
-                int16_t right = ntohs(*sdp++);
-                out_left[i] = static_cast<float>(left) / 32767.0f;
-                out_right[i] = static_cast<float>(right) / 32767.0f;
-            }
-        } else {
-            samples = 0;
+        if (latency_stats) {
+            record_latency();
         }
-    } else {
-        samples = 0;
+        if (rtcp && rtp.ssrc == pcm_session.get_ssrc()) {
+            // only the stream the session follows (it ignores the others)
+            rtcp->received(rtp, arrival_ns);
+        }
+        consume_packet();
     }
+    // Holes in the sequence may have timed out while we waited
+    pcm_session.drain(outs, noutput_items, output_items.size(), produced);
 
-    return offset + samples;
-}
-
-template <>
-int source_impl<std::int16_t>::output_samples(const void *dp,
-                                              int size,
-                                              int channels,
-                                              std::int16_t** outs,
-                                              int noutput_items,
-                                              int noutput_channels,
-                                              int offset) const
-{
-    int samples = size / (sizeof(int16_t) * channels);
-    // interleaved short case
-    if (channels == 2 && noutput_channels == 1) {
-        samples = size / sizeof(int16_t);
-    }
-    if (offset + samples > noutput_items) {
-        this->d_logger->warn("work buffer not large enough - dropping samples - buffer size={} samples={} offset={}", noutput_items, samples, offset);
-        samples = noutput_items - offset;
+    uint64_t const truncated = get_truncated();
+    if (truncated != truncations_reported) {
+        pcm_session.oversize(truncated - truncations_reported);
+        truncations_reported = truncated;
     }
 
-    auto sdp = static_cast<const int16_t *>(dp);
-    if (noutput_channels == 1) {
-        auto out = outs[0];
-        if (channels == 1 || channels == 2) {
-            // (in) channels == 1 -> standard mono
-            // (in) channels == 2 -> interleaved shorts (for raw I/Q)
-            for (int i = offset; i < offset + samples; i++) {
-                // Swap sample to host order
-                int16_t d = ntohs(*sdp++);
-                out[i] = d;
-            }
-        } else {
-            samples = 0;
-        }
-    } else if (noutput_channels == 2) {
-        auto out_left = outs[0];
-        auto out_right = outs[1];
-        if (channels == 1) {
-            // Expand to pseudo-stereo
-            for (int i = offset; i < offset + samples; i++) {
-                // Swap sample to host order
-                int16_t d = ntohs(*sdp++);
-                out_left[i] = d;
-                out_right[i] = d;
-            }
-        } else if (channels == 2) {
-            for (int i = offset; i < offset + samples; i++) {
-                // Swap sample to host order
-                int16_t left = ntohs(*sdp++);
-                int16_t right = ntohs(*sdp++);
-                out_left[i] = left;
-                out_right[i] = right;
-            }
-        } else {
-            samples = 0;
+    if (stats_interval.count() > 0) {
+        auto const now = std::chrono::steady_clock::now();
+        if (now >= next_stats) {
+            publish_stats();
+            next_stats = now + stats_interval;
         }
-    } else {
-        samples = 0;
     }
 
-    return offset + samples;
-}
-
-static void init(struct pcmstream *pc, struct rtp_header const *rtp,
-                 struct sockaddr const *sender) {
-    // First packet on stream, initialize
-    pc->ssrc = rtp->ssrc;
-    pc->type = rtp->type;
-
-    memcpy(&pc->sender,sender,sizeof(pc->sender)); // Remember sender
-    getnameinfo((struct sockaddr *)&pc->sender, sizeof(pc->sender),
-                pc->addr,sizeof(pc->addr),
-                pc->port,sizeof(pc->port), NI_NOFQDN | NI_DGRAM);
-    pc->rtp_state.timestamp = rtp->timestamp;
-    pc->rtp_state.seq = rtp->seq;
-    pc->rtp_state.packets = 0;
-    pc->rtp_state.bytes = 0;
-    pc->rtp_state.drops = 0;
-    pc->rtp_state.dupes = 0;
+    // Tell runtime system how many output items we produced.
+    return produced;
 }
 
 template class source<gr_complex>;
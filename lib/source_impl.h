@@ -14,69 +14,174 @@
 
 #include <gnuradio/rtp/source.h>
 
+#include <sys/socket.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "latency_histogram.h"
+#include "mcast_demux.h"
+#include "mcast_join.h"
 #include "multicast.h"
+#include "packet_ring.h"
+#include "rtcp.h"
+#include "rtp_info.h"
+#include "rx_batch.h"
+#include "session.h"
+#include "status_listener.h"
+#include "tpacket_rx.h"
+#include "uring_rx.h"
 
 namespace gr {
 namespace rtp {
 
-struct pcmstream {
-  uint32_t ssrc;            // RTP Sending Source ID
-  int type;                 // RTP type (10,11,20)
-
-  struct sockaddr sender;
-  char addr[NI_MAXHOST];    // RTP Sender IP address
-  char port[NI_MAXSERV];    // RTP Sender source port
-
-  struct rtp_state rtp_state;
-};
-
 template <class T>
 class source_impl : public source<T>
 {
 private:
     int mcast_fd;
-    struct pcmstream pcmstream;
+    std::unique_ptr<mcast_joiner> joiner; // async_join mode
+    session<T> pcm_session;
     unsigned int ssrc; // Requested SSRC
-    int channels;
-    bool quiet;
+
+    // recvmmsg() batch
+    int batch_size;
+    rx_batch rx;
+    int rx_count; // datagrams in current batch
+    int rx_next;  // next datagram to process
+    std::unique_ptr<tpacket_rx> packet_rx; // zero-copy input
+    std::unique_ptr<uring_rx> uring;       // io_uring input
+
+    // receiver thread mode
+    std::shared_ptr<packet_ring> ring;
+    mcast_demux::sptr demux; // shared socket mode
+    gr::thread::thread rx_thread;
+    std::atomic<bool> rx_stop;
+    rx_wakeup rx_wake;
+    bool rx_running;
+    std::vector<uint8_t> overrun_buffer;
+    uint64_t truncations_reported; // datagrams too big for the buffers, logged so far
+
+    // latency instrumentation
+    bool latency_stats;
+    latency_histogram kernel_latency; // kernel receive -> read from the socket
+    latency_histogram output_latency; // read from the socket -> output buffer
+    int64_t pkt_kernel_ns;            // timestamps of the current packet
+    int64_t pkt_recv_ns;
+
+    std::unique_ptr<rtcp_receiver> rtcp; // RTCP reports (optional)
+    std::unique_ptr<status_listener> stream_status; // radiod status (optional)
+
+    // stats messages
+    std::chrono::milliseconds stats_interval; // 0 = none
+    std::chrono::steady_clock::time_point next_stats;
 
 public:
     source_impl(const std::string& mcast_address,
                 unsigned int ssrc,
                 int in_channels=1,
                 int out_channels=1,
-                bool quiet=false);
+                bool quiet=false,
+                int batch_size=16,
+                int ring_depth=0,
+                bool shared_socket=false,
+                int jitter_packets=0,
+                int jitter_ms=0,
+                bool latency_stats=false,
+                bool async_join=false,
+                bool zero_copy=false,
+                bool io_uring=false,
+                bool rtcp=false,
+                const std::string& status_address="",
+                int stats_interval=1000);
     ~source_impl();
 
-    int get_bits_per_sample() const override {
-        return sizeof(std::int16_t) * 8;
-    }
+    bool start() override;
+    bool stop() override;
 
-    int get_channels() const override { return channels; };
+    int get_bits_per_sample() const override { return pcm_session.get_bits_per_sample(); };
+
+    int get_channels() const override { return pcm_session.get_channels(); };
 
     void set_ssrc(unsigned int ssrc) override {
         this->ssrc = ssrc;
-        pcmstream.ssrc = 0;
+        pcm_session.reset();
+        if (demux && rx_running) {
+            demux->subscribe(ssrc, ring);
+        }
     };
 
     unsigned int get_ssrc() const override { return ssrc; };
 
+    int get_batch_size() const override { return batch_size; };
+
+    int get_ring_depth() const override { return ring ? ring->depth() : 0; };
+
+    uint64_t get_ring_overruns() const override {
+        return ring ? ring->overruns() : packet_rx ? packet_rx->drops() : 0;
+    };
+
+    int get_ring_high_water() const override { return ring ? ring->high_water() : 0; };
+
+    uint64_t get_truncated() const override {
+        return (ring ? ring->truncations() : 0) + rx.truncations();
+    };
+
+    int get_jitter_depth() const override { return pcm_session.get_jitter_depth(); };
+
+    uint64_t get_packets() const override { return stream_stats::get(pcm_session.get_stats().packets); };
+
+    uint64_t get_bytes() const override { return stream_stats::get(pcm_session.get_stats().bytes); };
+
+    uint64_t get_drops() const override { return stream_stats::get(pcm_session.get_stats().drops); };
+
+    uint64_t get_dupes() const override { return stream_stats::get(pcm_session.get_stats().dupes); };
+
+    uint64_t get_zero_filled() const override {
+        return stream_stats::get(pcm_session.get_stats().zero_filled);
+    };
+
+    int get_reorder_depth() const override {
+        return pcm_session.get_stats().reorder_depth.load(std::memory_order_relaxed);
+    };
+
+    uint64_t get_reordered() const override { return pcm_session.get_reordered(); };
+
+    uint64_t get_late() const override { return pcm_session.get_late(); };
+
+    uint64_t get_lost() const override { return pcm_session.get_lost(); };
+
+    std::vector<float> get_kernel_latency() const override { return percentiles(kernel_latency); };
+
+    std::vector<float> get_output_latency() const override { return percentiles(output_latency); };
+
+    void reset_latency() override {
+        kernel_latency.reset();
+        output_latency.reset();
+    };
+
+    float get_interarrival_jitter() const override { return pcm_session.get_stats().jitter.ms(); };
+
+    int get_samp_rate() const override { return pcm_session.get_samprate(); };
+
+    double get_frequency() const override { return pcm_session.get_frequency(); };
+
+    void setup_rpc() override;
+
     int work(int noutput_items,
              gr_vector_const_void_star& input_items,
              gr_vector_void_star& output_items);
 
 private:
-    void check_out_channels(int channels) const { return; }
-    int get_output_items(int sampcount, int channels, int noutput_channels, int time_step) const {
-        return time_step + sampcount / channels;  // == sampcount for mono, sampcount/2 for stereo
-    }
-    int output_zeroes(int nzeroes, int channels, T** outs,
-                      int noutput_items, int noutput_channels,
-                      int offset = 0) const;
-    int output_samples(const void *dp, int size, int channels, T** outs,
-                       int noutput_items, int noutput_channels,
-                       int offset = 0) const;
-
+    void receiver();
+    bool next_packet(bool wait, uint8_t const **data, int *size,
+                     struct sockaddr const **sender);
+    void consume_packet();
+    void record_latency();
+    void publish_status(const channel_status& status);
+    void publish_stats();
+    static std::vector<float> percentiles(const latency_histogram& h);
 };
 
 } // namespace rtp
@@ -0,0 +1,288 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 Franco Venturi.
+ *
+ * based on:
+ * - status.c in ka9q-radio
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "status_listener.h"
+
+#include <unistd.h>
+#include <cstring>
+#include <random>
+
+#include "mcast_join.h"
+#include "multicast.h"
+
+namespace gr {
+namespace rtp {
+
+// ka9q-radio status protocol (status.h): a packet type byte, then
+// type-length-value items up to EOL; integers are big-endian with the
+// leading zero bytes left out, doubles are sent as their 64 bit pattern
+static int const Status_packet = 0;
+static int const Command_packet = 1;
+
+static int const Eol = 0;
+static int const Command_tag = 1;
+static int const Output_ssrc = 18;
+static int const Output_samprate = 20;
+static int const Radio_frequency = 33;
+static int const Output_channels = 49;
+static int const Output_encoding = 107;
+
+// radiod sample encodings (enum encoding in rtp.h)
+static int const S16le_encoding = 1;
+static int const S16be_encoding = 2;
+static int const F32le_encoding = 4;
+
+static uint64_t decode_int(uint8_t const *dp, int len)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < len && i < 8; i++) {
+        value = value << 8 | dp[i];
+    }
+    return value;
+}
+
+static double decode_double(uint8_t const *dp, int len)
+{
+    if (len == 4) {
+        // sent as a float
+        uint32_t const bits = decode_int(dp, len);
+        float f;
+        memcpy(&f, &bits, sizeof(f));
+        return f;
+    }
+    uint64_t const bits = decode_int(dp, len);
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+
+static uint8_t *encode_int(uint8_t *dp, int type, uint64_t value)
+{
+    int len = 0;
+    while (len < 8 && (value >> (8 * len)) != 0) {
+        len++;
+    }
+    *dp++ = type;
+    *dp++ = len;
+    for (int i = len - 1; i >= 0; i--) {
+        *dp++ = value >> (8 * i);
+    }
+    return dp;
+}
+
+status_listener::status_listener(const std::string& target,
+                                 const gr::logger_ptr& logger,
+                                 const std::function<void(const channel_status&)>& changed)
+    : d_target(target),
+      d_logger(logger),
+      d_changed(changed),
+      d_in_fd(-1),
+      d_out_fd(-1),
+      d_wanted(0),
+      d_tag(std::random_device()()),
+      d_status{},
+      d_updates(0),
+      d_stop(false),
+      d_poll_now(false)
+{
+    d_thread = gr::thread::thread([this] { run(); });
+}
+
+status_listener::~status_listener()
+{
+    d_stop = true;
+    d_wake.notify();
+    d_thread.join();
+    if (d_out_fd != -1) {
+        close(d_out_fd);
+    }
+    if (d_in_fd != -1) {
+        close(d_in_fd);
+    }
+}
+
+void status_listener::want(uint32_t ssrc)
+{
+    if (d_wanted.exchange(ssrc) != ssrc) {
+        d_poll_now = true;
+        d_wake.notify();
+    }
+}
+
+bool status_listener::get(uint32_t ssrc, channel_status& status) const
+{
+    gr::thread::scoped_lock lock(d_mutex);
+    if (ssrc == 0 || d_status.ssrc != ssrc) {
+        return false;
+    }
+    status = d_status;
+    return true;
+}
+
+// Background thread: join the status group, then read status packets and
+// poll radiod until destroyed
+void status_listener::run()
+{
+    bool warned = false;
+    auto next_poll = std::chrono::steady_clock::now();
+    while (!d_stop) {
+        if (d_in_fd == -1 && !setup()) {
+            if (!warned) {
+                d_logger->warn("Can't listen to status on \"{}\" - retrying every {} sec",
+                               d_target, Retry_interval);
+                warned = true;
+            }
+            d_wake.wait(-1, Retry_interval * 1000);
+            continue;
+        }
+        auto const now = std::chrono::steady_clock::now();
+        if (d_poll_now.exchange(false) || now >= next_poll) {
+            poll();
+            next_poll = now + std::chrono::seconds(Poll_interval);
+        }
+        int const timeout_ms =
+            std::chrono::duration_cast<std::chrono::milliseconds>(next_poll - now).count() + 1;
+        if (d_wake.wait(d_in_fd, timeout_ms)) {
+            receive();
+        }
+    }
+}
+
+bool status_listener::setup()
+{
+    mcast_target t;
+    if (!mcast_resolver::resolve(d_target, t, DEFAULT_STAT_PORT)) {
+        return false;
+    }
+    int const in_fd = mcast_resolver::listen(t);
+    int const out_fd = in_fd == -1 ? -1 : mcast_resolver::connect(t, 1);
+    if (out_fd == -1) {
+        if (in_fd != -1) {
+            close(in_fd);
+        }
+        return false;
+    }
+    d_in_fd = in_fd;
+    d_out_fd = out_fd;
+    d_logger->info("Listening to status on {}", formatsock(&t.sock));
+    return true;
+}
+
+// Ask radiod for the status of the wanted stream
+void status_listener::poll()
+{
+    uint32_t const ssrc = d_wanted;
+    if (ssrc == 0) {
+        return;
+    }
+    uint8_t buffer[32];
+    uint8_t *dp = buffer;
+    *dp++ = Command_packet;
+    dp = encode_int(dp, Output_ssrc, ssrc);
+    dp = encode_int(dp, Command_tag, d_tag++);
+    *dp++ = Eol;
+    send(d_out_fd, buffer, dp - buffer, MSG_DONTWAIT);
+}
+
+void status_listener::receive()
+{
+    uint8_t buffer[Packet_slot_size];
+    for (;;) {
+        int const len = recv(d_in_fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (len <= 0) {
+            return;
+        }
+        channel_status status;
+        if (!decode(buffer, len, status) || status.ssrc != d_wanted) {
+            continue;
+        }
+        {
+            gr::thread::scoped_lock lock(d_mutex);
+            if (status.ssrc == d_status.ssrc && status.samprate == d_status.samprate &&
+                status.channels == d_status.channels && status.frequency == d_status.frequency &&
+                status.output_encoding == d_status.output_encoding) {
+                continue;
+            }
+            d_status = status;
+        }
+        d_updates.fetch_add(1, std::memory_order_release);
+        if (d_changed) {
+            d_changed(status);
+        }
+    }
+}
+
+// Decode a status packet; returns false if it's not about a stream
+bool status_listener::decode(uint8_t const *data, int len, channel_status& status) const
+{
+    if (len < 1 || data[0] != Status_packet) {
+        return false;
+    }
+    memset(&status, 0, sizeof(status));
+    uint8_t const *dp = data + 1;
+    uint8_t const *const end = data + len;
+    while (end - dp >= 2) {
+        int const type = *dp++;
+        if (type == Eol) {
+            break;
+        }
+        int optlen = *dp++;
+        if (optlen & 0x80) {
+            // long item: the low bits are the number of length bytes
+            int n = optlen & 0x7f;
+            optlen = 0;
+            while (n-- > 0 && dp < end) {
+                optlen = optlen << 8 | *dp++;
+            }
+        }
+        if (optlen < 0 || optlen > end - dp) {
+            break; // truncated
+        }
+        switch (type) {
+        case Output_ssrc:
+            status.ssrc = decode_int(dp, optlen);
+            break;
+        case Output_samprate:
+            status.samprate = decode_int(dp, optlen);
+            break;
+        case Output_channels:
+            status.channels = decode_int(dp, optlen);
+            break;
+        case Radio_frequency:
+            status.frequency = decode_double(dp, optlen);
+            break;
+        case Output_encoding:
+            status.output_encoding = decode_int(dp, optlen);
+            break;
+        default:
+            break;
+        }
+        dp += optlen;
+    }
+    return status.ssrc != 0;
+}
+
+payload_format status_format(int output_encoding)
+{
+    switch (output_encoding) {
+    case S16le_encoding:
+        return { encoding::S16LE, 0, 16 };
+    case S16be_encoding:
+        return { encoding::S16BE, 0, 16 };
+    case F32le_encoding:
+        return { encoding::F32LE, 0, 32 };
+    default:
+        // Opus, AX.25, 16-bit float
+        return { encoding::NONE, 0, 0 };
+    }
+}
+
+} // namespace rtp
+} // namespace gr
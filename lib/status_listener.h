@@ -0,0 +1,96 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 Franco Venturi.
+ *
+ * based on:
+ * - status.c in ka9q-radio
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_RTP_STATUS_LISTENER_H
+#define INCLUDED_RTP_STATUS_LISTENER_H
+
+#include <gnuradio/logger.h>
+#include <gnuradio/thread/thread.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "convert.h"
+#include "rx_batch.h"
+
+namespace gr {
+namespace rtp {
+
+// What radiod says about one of its output streams
+struct channel_status {
+    uint32_t ssrc;
+    int samprate;     // Hz (0 = not reported)
+    int channels;     // 0 = not reported
+    double frequency; // radio frequency in Hz (0 = not reported)
+    int output_encoding; // radiod sample encoding (0 = not reported)
+};
+
+// Sample format of a radiod output_encoding (channels 0: not given by it)
+payload_format status_format(int output_encoding);
+
+// Listener for the status multicast of ka9q-radio radiod
+// radiod describes each of its channels in TLV status packets on its status
+// group (port 5006 by default). A background thread keeps the latest status
+// of the wanted stream, and polls radiod for it every Poll_interval seconds
+// (radiod answers on the group). The group is resolved and joined in the
+// background, retried every Retry_interval until it works.
+class status_listener
+{
+public:
+    static constexpr int Poll_interval = 10; // seconds
+    static constexpr int Retry_interval = 10; // seconds
+
+    // changed is called from the listener thread when the status of the
+    // wanted stream changes
+    status_listener(const std::string& target,
+                    const gr::logger_ptr& logger,
+                    const std::function<void(const channel_status&)>& changed = nullptr);
+    ~status_listener();
+
+    // Stream to poll radiod for, and to report changes of (0 = none)
+    void want(uint32_t ssrc);
+
+    // Latest status of stream ssrc; returns false if there is none
+    bool get(uint32_t ssrc, channel_status& status) const;
+
+    // Number of status changes seen so far (changes with each one)
+    uint32_t updates() const { return d_updates.load(std::memory_order_acquire); }
+
+private:
+    void run();
+    bool setup();
+    void receive();
+    void poll();
+    bool decode(uint8_t const *data, int len, channel_status& status) const;
+
+    std::string const d_target;
+    gr::logger_ptr d_logger;
+    std::function<void(const channel_status&)> const d_changed;
+    int d_in_fd;  // status
+    int d_out_fd; // polls
+    std::atomic<uint32_t> d_wanted;
+    uint32_t d_tag; // command tag of our polls
+
+    mutable gr::thread::mutex d_mutex;
+    channel_status d_status; // of the wanted stream (ssrc 0 = none yet)
+    std::atomic<uint32_t> d_updates;
+
+    gr::thread::thread d_thread;
+    std::atomic<bool> d_stop;
+    std::atomic<bool> d_poll_now;
+    rx_wakeup d_wake;
+};
+
+} // namespace rtp
+} // namespace gr
+
+#endif /* INCLUDED_RTP_STATUS_LISTENER_H */
@@ -0,0 +1,109 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 Franco Venturi.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_RTP_STREAM_STATS_H
+#define INCLUDED_RTP_STREAM_STATS_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace gr {
+namespace rtp {
+
+// Interarrival jitter of an RTP stream (RFC 3550 A.8)
+// update() is called from a single thread; the estimate can be read from any
+class interarrival_jitter
+{
+public:
+    interarrival_jitter() : d_jitter(0), d_samprate(0), d_transit(0), d_have_transit(false) {}
+
+    // Start over (new stream)
+    void reset()
+    {
+        d_jitter.store(0, std::memory_order_relaxed);
+        d_have_transit = false;
+    }
+
+    // Account for a packet with RTP timestamp that arrived at arrival_ns
+    // (ns since the epoch); a new sample rate starts over
+    void update(uint32_t timestamp, int samprate, int64_t arrival_ns)
+    {
+        auto const relaxed = std::memory_order_relaxed;
+        if (samprate != d_samprate.load(relaxed)) {
+            d_samprate.store(samprate, relaxed);
+            reset();
+        }
+        if (samprate <= 0) {
+            return;
+        }
+        uint32_t const arrival = static_cast<uint64_t>(double(arrival_ns) * 1e-9 * samprate);
+        uint32_t const transit = arrival - timestamp;
+        if (d_have_transit) {
+            int32_t d = static_cast<int32_t>(transit - d_transit);
+            uint32_t const jitter = d_jitter.load(relaxed);
+            d = d < 0 ? -d : d;
+            d_jitter.store(jitter + d - ((jitter + 8) >> 4), relaxed);
+        }
+        d_transit = transit;
+        d_have_transit = true;
+    }
+
+    // In timestamp units, as in RTCP receiver reports
+    uint32_t units() const { return d_jitter.load(std::memory_order_relaxed) >> 4; }
+
+    // In ms (0 until the sample rate is known)
+    float ms() const
+    {
+        int const samprate = d_samprate.load(std::memory_order_relaxed);
+        return samprate > 0 ? float(units()) * 1e3f / samprate : 0.0f;
+    }
+
+private:
+    std::atomic<uint32_t> d_jitter; // in timestamp units, times 16
+    std::atomic<int> d_samprate;
+    uint32_t d_transit;             // of the previous packet
+    bool d_have_transit;
+};
+
+// Telemetry of the RTP stream of a session, since the block started
+// Only the thread running work() writes the counters, so they are relaxed
+// atomics updated with a plain load and store: readers (getters, stats
+// messages, ControlPort) never hold up the receive path
+struct stream_stats {
+    std::atomic<uint64_t> packets{ 0 };     // received on the stream
+    std::atomic<uint64_t> bytes{ 0 };       // payload bytes received
+    std::atomic<uint64_t> drops{ 0 };       // missing from the sequence when played
+    std::atomic<uint64_t> dupes{ 0 };       // duplicate or too old to play
+    std::atomic<uint64_t> reordered{ 0 };   // put back in sequence by the jitter buffer
+    std::atomic<uint64_t> late{ 0 };        // arrived after their turn in the jitter buffer
+    std::atomic<uint64_t> lost{ 0 };        // given up on by the jitter buffer
+    std::atomic<uint64_t> zero_filled{ 0 }; // frames of zeroes output for missing samples
+    std::atomic<int> reorder_depth{ 0 };    // most packets one arrived behind a later one
+    interarrival_jitter jitter;
+
+    static void add(std::atomic<uint64_t>& counter, uint64_t n)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    static uint64_t get(std::atomic<uint64_t> const& counter)
+    {
+        return counter.load(std::memory_order_relaxed);
+    }
+
+    void reordered_by(int depth)
+    {
+        if (depth > reorder_depth.load(std::memory_order_relaxed)) {
+            reorder_depth.store(depth, std::memory_order_relaxed);
+        }
+    }
+};
+
+} // namespace rtp
+} // namespace gr
+
+#endif /* INCLUDED_RTP_STREAM_STATS_H */
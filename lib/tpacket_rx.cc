@@ -0,0 +1,281 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 Franco Venturi.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "tpacket_rx.h"
+
+#include <arpa/inet.h>
+#include <linux/filter.h>
+#include <linux/if_packet.h>
+#include <net/ethernet.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+#include "multicast.h"
+#include "rx_batch.h"
+
+namespace gr {
+namespace rtp {
+
+static int const Ring_size = tpacket_rx::Block_size * tpacket_rx::Block_count;
+
+// Classic BPF program accepting only the UDP datagrams for the group and port
+// of sock (offsets are from the IP header, as the packet socket is SOCK_DGRAM)
+static std::vector<struct sock_filter> make_filter(struct sockaddr_storage const& sock)
+{
+    uint32_t const accept = 0xffffffff; // whole packet
+    if (sock.ss_family == AF_INET) {
+        auto sin = reinterpret_cast<struct sockaddr_in const *>(&sock);
+        return {
+            BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 9),                          // protocol
+            BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_UDP, 0, 8),
+            BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 16),                         // destination
+            BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ntohl(sin->sin_addr.s_addr), 0, 6),
+            BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 6),                          // fragment
+            BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x3fff, 4, 0),
+            BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 0),                         // header length
+            BPF_STMT(BPF_LD | BPF_H | BPF_IND, 2),                          // UDP dest port
+            BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ntohs(sin->sin_port), 0, 1),
+            BPF_STMT(BPF_RET | BPF_K, accept),
+            BPF_STMT(BPF_RET | BPF_K, 0),
+        };
+    }
+    if (sock.ss_family == AF_INET6) {
+        auto sin6 = reinterpret_cast<struct sockaddr_in6 const *>(&sock);
+        uint32_t group[4];
+        memcpy(group, &sin6->sin6_addr, sizeof(group));
+        return {
+            BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 6),                          // next header
+            BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_UDP, 0, 11),
+            BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 24),                         // destination
+            BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ntohl(group[0]), 0, 9),
+            BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 28),
+            BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ntohl(group[1]), 0, 7),
+            BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 32),
+            BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ntohl(group[2]), 0, 5),
+            BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 36),
+            BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ntohl(group[3]), 0, 3),
+            BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 42),                         // UDP dest port
+            BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ntohs(sin6->sin6_port), 0, 1),
+            BPF_STMT(BPF_RET | BPF_K, accept),
+            BPF_STMT(BPF_RET | BPF_K, 0),
+        };
+    }
+    return {};
+}
+
+static bool attach_filter(int fd, std::vector<struct sock_filter>& filter)
+{
+    struct sock_fprog prog;
+    prog.len = filter.size();
+    prog.filter = filter.data();
+    return setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) == 0;
+}
+
+std::unique_ptr<tpacket_rx> tpacket_rx::open(const mcast_target& target,
+                                             int membership_fd,
+                                             const gr::logger_ptr& logger)
+{
+    std::unique_ptr<tpacket_rx> rx(new tpacket_rx());
+    std::string const error = rx->setup(target);
+    if (!error.empty()) {
+        logger->warn("Zero-copy input not available ({}) - using the UDP socket", error);
+        return nullptr;
+    }
+    // The socket only keeps the group joined now
+    std::vector<struct sock_filter> drop = { BPF_STMT(BPF_RET | BPF_K, 0) };
+    attach_filter(membership_fd, drop);
+    return rx;
+}
+
+tpacket_rx::tpacket_rx()
+    : d_fd(-1),
+      d_map(NULL),
+      d_block(0),
+      d_held(false),
+      d_recv_ns(0),
+      d_drops(0)
+{
+    // Enough for a block full of minimum size datagrams
+    d_packets.resize(Block_size / 64);
+}
+
+tpacket_rx::~tpacket_rx()
+{
+    if (d_map != NULL) {
+        munmap(d_map, Ring_size);
+    }
+    if (d_fd != -1) {
+        close(d_fd);
+    }
+}
+
+// Returns an error message, empty if OK
+std::string tpacket_rx::setup(const mcast_target& target)
+{
+    int const family = target.sock.ss_family;
+    uint16_t const protocol = htons(family == AF_INET6 ? ETH_P_IPV6 : ETH_P_IP);
+    std::vector<struct sock_filter> filter = make_filter(target.sock);
+    if (filter.empty()) {
+        return "unsupported address family";
+    }
+
+    // Protocol 0 until bind(), so nothing is queued before the filter is in place
+    d_fd = socket(AF_PACKET, SOCK_DGRAM, 0);
+    if (d_fd == -1) {
+        return std::string("AF_PACKET socket: ") + strerror(errno);
+    }
+    if (!attach_filter(d_fd, filter)) {
+        return std::string("SO_ATTACH_FILTER: ") + strerror(errno);
+    }
+    int const version = TPACKET_V3;
+    if (setsockopt(d_fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) != 0) {
+        return std::string("TPACKET_V3: ") + strerror(errno);
+    }
+#ifdef PACKET_IGNORE_OUTGOING
+    // Our own transmissions (checked again in parse() for older kernels)
+    int const on = 1;
+    setsockopt(d_fd, SOL_PACKET, PACKET_IGNORE_OUTGOING, &on, sizeof(on));
+#endif
+
+    struct tpacket_req3 req;
+    memset(&req, 0, sizeof(req));
+    req.tp_block_size = Block_size;
+    req.tp_block_nr = Block_count;
+    req.tp_frame_size = Frame_size;
+    req.tp_frame_nr = (Block_size / Frame_size) * Block_count;
+    req.tp_retire_blk_tov = Block_timeout_ms;
+    if (setsockopt(d_fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) != 0) {
+        return std::string("PACKET_RX_RING: ") + strerror(errno);
+    }
+    void *map = mmap(NULL, Ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, d_fd, 0);
+    if (map == MAP_FAILED) {
+        return std::string("mmap: ") + strerror(errno);
+    }
+    d_map = static_cast<uint8_t *>(map);
+
+    struct sockaddr_ll ll;
+    memset(&ll, 0, sizeof(ll));
+    ll.sll_family = AF_PACKET;
+    ll.sll_protocol = protocol;
+    char const *iface = target.iface.empty() ? Default_mcast_iface : target.iface.c_str();
+    if (iface != NULL && strlen(iface) > 0) {
+        ll.sll_ifindex = if_nametoindex(iface);
+        if (ll.sll_ifindex == 0) {
+            return std::string("unknown interface ") + iface;
+        }
+    }
+    if (bind(d_fd, reinterpret_cast<struct sockaddr *>(&ll), sizeof(ll)) != 0) {
+        return std::string("AF_PACKET bind: ") + strerror(errno);
+    }
+    return "";
+}
+
+int tpacket_rx::receive(bool wait)
+{
+    if (d_held) {
+        // Done with the previous block: give it back
+        int const previous = (d_block + Block_count - 1) % Block_count;
+        auto bd = reinterpret_cast<struct tpacket_block_desc *>(d_map + previous * Block_size);
+        __atomic_store_n(&bd->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+        d_held = false;
+    }
+
+    auto bd = reinterpret_cast<struct tpacket_block_desc *>(d_map + d_block * Block_size);
+    if ((__atomic_load_n(&bd->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) == 0) {
+        if (!wait) {
+            return 0;
+        }
+        struct pollfd pfd;
+        pfd.fd = d_fd;
+        pfd.events = POLLIN | POLLERR;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, Poll_timeout_ms) <= 0 ||
+            (__atomic_load_n(&bd->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) == 0) {
+            return 0;
+        }
+    }
+    d_recv_ns = rx_batch::now_ns();
+    d_held = true;
+    d_block = (d_block + 1) % Block_count;
+
+    int const npkts = bd->hdr.bh1.num_pkts;
+    if (npkts > (int)d_packets.size()) {
+        d_packets.resize(npkts);
+    }
+    int count = 0;
+    auto frame = reinterpret_cast<uint8_t const *>(bd) + bd->hdr.bh1.offset_to_first_pkt;
+    for (int i = 0; i < npkts; i++) {
+        auto hdr = reinterpret_cast<struct tpacket3_hdr const *>(frame);
+        if (parse(frame, d_packets[count])) {
+            count++;
+        }
+        frame += hdr->tp_next_offset;
+    }
+    return count;
+}
+
+// Locate the UDP payload of a frame and fill in its sender and time
+bool tpacket_rx::parse(uint8_t const *frame, packet& p) const
+{
+    auto hdr = reinterpret_cast<struct tpacket3_hdr const *>(frame);
+    auto ll = reinterpret_cast<struct sockaddr_ll const *>(
+        frame + TPACKET_ALIGN(sizeof(struct tpacket3_hdr)));
+    if (ll->sll_pkttype == PACKET_OUTGOING) {
+        return false;
+    }
+    uint8_t const *ip = frame + hdr->tp_net;
+    int const caplen = hdr->tp_snaplen;
+    if (hdr->tp_snaplen != hdr->tp_len) {
+        return false; // truncated
+    }
+
+    uint8_t const *udp;
+    memset(&p.sender, 0, sizeof(p.sender));
+    if ((ip[0] >> 4) == 4) {
+        int const ihl = (ip[0] & 0xf) * 4;
+        udp = ip + ihl;
+        auto sin = reinterpret_cast<struct sockaddr_in *>(&p.sender);
+        sin->sin_family = AF_INET;
+        memcpy(&sin->sin_addr, ip + 12, 4);
+        memcpy(&sin->sin_port, udp, 2);
+    } else if ((ip[0] >> 4) == 6) {
+        udp = ip + 40;
+        auto sin6 = reinterpret_cast<struct sockaddr_in6 *>(&p.sender);
+        sin6->sin6_family = AF_INET6;
+        memcpy(&sin6->sin6_addr, ip + 8, 16);
+        memcpy(&sin6->sin6_port, udp, 2);
+    } else {
+        return false;
+    }
+    int const udp_len = (udp[4] << 8) | udp[5];
+    if (udp + udp_len > ip + caplen || udp_len < 8) {
+        return false;
+    }
+    p.data = udp + 8;
+    p.len = udp_len - 8;
+    p.kernel_ns = int64_t(hdr->tp_sec) * 1000000000 + hdr->tp_nsec;
+    return true;
+}
+
+uint64_t tpacket_rx::drops() const
+{
+    struct tpacket_stats_v3 stats;
+    socklen_t len = sizeof(stats);
+    // Reading the statistics resets them
+    if (getsockopt(d_fd, SOL_PACKET, PACKET_STATISTICS, &stats, &len) == 0) {
+        d_drops += stats.tp_drops;
+    }
+    return d_drops;
+}
+
+} // namespace rtp
+} // namespace gr
@@ -0,0 +1,95 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 Franco Venturi.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_RTP_TPACKET_RX_H
+#define INCLUDED_RTP_TPACKET_RX_H
+
+#include <gnuradio/logger.h>
+
+#include <sys/socket.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mcast_join.h"
+
+namespace gr {
+namespace rtp {
+
+// Zero-copy multicast input through a memory-mapped AF_PACKET (TPACKET_V3) ring
+// The kernel packs the received frames into blocks of a ring shared with us;
+// a classic BPF filter on the packet socket only lets in the UDP datagrams
+// for the group and port. receive() hands out the datagrams of one block in
+// place (pointers into the mapped block), and the block goes back to the
+// kernel with the next receive(), so payloads are decoded straight from the
+// ring into the output buffer.
+// The group is still joined with a regular UDP socket (for IGMP/MLD and the
+// NIC filters), which gets a drop-all filter so it doesn't queue a copy.
+// Limitations: IP fragments are dropped (no reassembly), IPv6 extension
+// headers aren't supported, and UDP checksums aren't verified.
+class tpacket_rx
+{
+public:
+    static int const Block_size = 1 << 18;   // bytes
+    static int const Block_count = 64;       // 16 MB ring
+    static int const Frame_size = 2048;      // only used to size the ring
+    static int const Block_timeout_ms = 2;   // hand over partially filled blocks
+    static int const Poll_timeout_ms = 100;  // so the caller can check for stop
+
+    // Set up the ring for the (already joined) target
+    // Returns nullptr if it can't be set up, e.g. without CAP_NET_RAW:
+    // the caller keeps reading membership_fd as usual then
+    static std::unique_ptr<tpacket_rx> open(const mcast_target& target,
+                                            int membership_fd,
+                                            const gr::logger_ptr& logger);
+    ~tpacket_rx();
+
+    // Return the previous block to the kernel and take the next one
+    // When wait is true, wait up to Poll_timeout_ms for it
+    // Returns the number of datagrams in the block, 0 if none are available
+    int receive(bool wait);
+
+    uint8_t const *data(int i) const { return d_packets[i].data; }
+    int len(int i) const { return d_packets[i].len; }
+    struct sockaddr const *sender(int i) const
+    {
+        return reinterpret_cast<struct sockaddr const *>(&d_packets[i].sender);
+    }
+    // Kernel receive time of datagram i in ns since the epoch
+    int64_t kernel_ns(int i) const { return d_packets[i].kernel_ns; }
+    // Time the last receive() returned, in ns since the epoch
+    int64_t recv_ns() const { return d_recv_ns; }
+
+    // Datagrams dropped by the kernel because the ring was full
+    uint64_t drops() const;
+
+private:
+    struct packet {
+        uint8_t const *data;
+        int len;
+        int64_t kernel_ns;
+        struct sockaddr_storage sender;
+    };
+
+    tpacket_rx();
+    std::string setup(const mcast_target& target);
+    bool parse(uint8_t const *frame, packet& p) const;
+
+    int d_fd;
+    uint8_t *d_map;
+    int d_block;   // next block to read
+    bool d_held;   // block d_block - 1 is still ours
+    std::vector<packet> d_packets;
+    int64_t d_recv_ns;
+    mutable uint64_t d_drops;
+};
+
+} // namespace rtp
+} // namespace gr
+
+#endif /* INCLUDED_RTP_TPACKET_RX_H */
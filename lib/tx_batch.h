@@ -0,0 +1,83 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 Franco Venturi.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_RTP_TX_BATCH_H
+#define INCLUDED_RTP_TX_BATCH_H
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "packet_arena.h"
+
+namespace gr {
+namespace rtp {
+
+// A batch of datagrams sent with sendmmsg() on a connected socket
+// The datagrams are built in place in a packet arena, then go out with
+// as few system calls as the socket buffer allows
+class tx_batch
+{
+public:
+    tx_batch(int size, int buffer_size)
+        : d_buffers(size, buffer_size), d_iovecs(size), d_msgs(size)
+    {
+        memset(d_msgs.data(), 0, d_msgs.size() * sizeof(struct mmsghdr));
+        for (int i = 0; i < size; i++) {
+            d_iovecs[i].iov_base = d_buffers.slot(i);
+            d_iovecs[i].iov_len = 0;
+            d_msgs[i].msg_hdr.msg_iov = &d_iovecs[i];
+            d_msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+    }
+
+    int size() const { return d_buffers.count(); }
+    int buffer_size() const { return d_buffers.slot_size(); }
+
+    uint8_t *data(int i) const { return d_buffers.slot(i); }
+    void set_len(int i, int len) { d_iovecs[i].iov_len = len; }
+
+    // Send datagrams [first, first + n) on fd
+    // While the socket buffer is full, wait up to timeout_ms for room
+    // Returns the number of datagrams sent, 0 on timeout, -1 on error (errno set)
+    int send(int fd, int first, int n, int timeout_ms)
+    {
+        for (;;) {
+            int const sent = sendmmsg(fd, &d_msgs[first], n, MSG_DONTWAIT);
+            if (sent > 0) {
+                return sent;
+            }
+            if (sent == -1 && errno == EINTR) {
+                continue;
+            }
+            if (sent == -1 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                return -1;
+            }
+            struct pollfd pfd = { fd, POLLOUT, 0 };
+            int const ready = poll(&pfd, 1, timeout_ms);
+            if (ready == 0) {
+                return 0;
+            }
+            if (ready == -1 && errno != EINTR) {
+                return -1;
+            }
+        }
+    }
+
+private:
+    packet_arena d_buffers;
+    std::vector<struct iovec> d_iovecs;
+    std::vector<struct mmsghdr> d_msgs;
+};
+
+} // namespace rtp
+} // namespace gr
+
+#endif /* INCLUDED_RTP_TX_BATCH_H */
@@ -0,0 +1,445 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 Franco Venturi.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "uring_rx.h"
+
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+#include "rx_batch.h"
+
+namespace gr {
+namespace rtp {
+
+// user_data of our two requests
+static uint64_t const Recv_tag = 1;
+static uint64_t const Wakeup_tag = 2;
+
+static int const Control_size = CMSG_SPACE(sizeof(struct timespec));
+
+// Entry i of a provided buffer ring
+// (not through bufs[]: in C++ the uapi flexible array is offset by an empty struct)
+static inline struct io_uring_buf *buf_entry(struct io_uring_buf_ring *br, unsigned i)
+{
+    return reinterpret_cast<struct io_uring_buf *>(br) + i;
+}
+
+static int io_uring_setup(unsigned entries, struct io_uring_params *p)
+{
+    return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+                          unsigned flags, void *arg, size_t argsz)
+{
+    return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz);
+}
+
+static int io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args)
+{
+    return syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+std::unique_ptr<uring_rx> uring_rx::open(int fd,
+                                         int batch_size,
+                                         bool timestamps,
+                                         const gr::logger_ptr& logger)
+{
+    // Multishot recvmsg came with Linux 6.0
+    struct utsname u;
+    int major = 0, minor = 0;
+    if (uname(&u) != 0 || sscanf(u.release, "%d.%d", &major, &minor) != 2 || major < 6) {
+        logger->warn("io_uring input needs Linux 6.0 or later - using recvmmsg()");
+        return nullptr;
+    }
+    std::unique_ptr<uring_rx> rx(new uring_rx(fd, batch_size, timestamps, logger));
+    int const error = rx->setup();
+    if (error != 0) {
+        logger->warn("io_uring input not available ({}) - using recvmmsg()", strerror(error));
+        return nullptr;
+    }
+    return rx;
+}
+
+uring_rx::uring_rx(int fd, int batch_size, bool timestamps, const gr::logger_ptr& logger)
+    : d_logger(logger),
+      d_fd(fd),
+      d_batch_size(std::max(1, std::min(batch_size, Buffer_count / 2))),
+      d_timestamps(timestamps),
+      // recvmsg header, sender address, control messages, payload
+      d_buffer_size((sizeof(struct io_uring_recvmsg_out) + sizeof(struct sockaddr_storage) +
+                     (timestamps ? Control_size : 0) + Payload_size + 63) & ~63),
+      d_ring_fd(-1),
+      d_event_fd(-1),
+      d_sq_map(MAP_FAILED),
+      d_sq_map_size(0),
+      d_cq_map(MAP_FAILED),
+      d_cq_map_size(0),
+      d_sqes(NULL),
+      d_sqes_size(0),
+      d_sq_pending(0),
+      d_buf_ring(NULL),
+      d_buf_ring_size(0),
+      d_buf_tail(0),
+      d_buffers(Buffer_count * d_buffer_size),
+      d_recv_armed(false),
+      d_wakeup_armed(false),
+      d_woken(false),
+      d_packets(d_batch_size),
+      d_count(0),
+      d_recv_ns(0),
+      d_overruns(0),
+      d_recv_failing(false)
+{
+    memset(&d_msg, 0, sizeof(d_msg));
+    d_msg.msg_namelen = sizeof(struct sockaddr_storage);
+    d_msg.msg_controllen = timestamps ? Control_size : 0;
+}
+
+uring_rx::~uring_rx()
+{
+    if (d_ring_fd != -1) {
+        // Stop the kernel from writing into the buffers before they go away
+        if (d_recv_armed) {
+            struct io_uring_sqe *sqe = get_sqe();
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->fd = -1;
+            sqe->addr = Recv_tag;
+            submit();
+            for (int i = 0; i < 10 && d_recv_armed; i++) {
+                recycle();
+                d_count = 0;
+                if (harvest() == 0) {
+                    struct __kernel_timespec ts = { 0, 10000000 };
+                    struct io_uring_getevents_arg arg;
+                    memset(&arg, 0, sizeof(arg));
+                    arg.ts = reinterpret_cast<uint64_t>(&ts);
+                    io_uring_enter(d_ring_fd, 0, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+                                   &arg, sizeof(arg));
+                }
+            }
+        }
+        close(d_ring_fd);
+    }
+    if (d_sqes != NULL) {
+        munmap(d_sqes, d_sqes_size);
+    }
+    if (d_cq_map != MAP_FAILED && d_cq_map != d_sq_map) {
+        munmap(d_cq_map, d_cq_map_size);
+    }
+    if (d_sq_map != MAP_FAILED) {
+        munmap(d_sq_map, d_sq_map_size);
+    }
+    if (d_buf_ring != NULL) {
+        munmap(d_buf_ring, d_buf_ring_size);
+    }
+    if (d_event_fd != -1) {
+        close(d_event_fd);
+    }
+}
+
+// Returns 0 or an errno value
+int uring_rx::setup()
+{
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    // Room for a completion per buffer, plus the wakeups
+    p.flags = IORING_SETUP_CQSIZE;
+    p.cq_entries = 2 * Buffer_count;
+    d_ring_fd = io_uring_setup(8, &p);
+    if (d_ring_fd == -1) {
+        return errno;
+    }
+    if (!(p.features & IORING_FEAT_EXT_ARG)) {
+        return ENOSYS; // no wait with timeout
+    }
+
+    // Map the queues
+    d_sq_map_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    d_cq_map_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        d_sq_map_size = d_cq_map_size = std::max(d_sq_map_size, d_cq_map_size);
+    }
+    d_sq_map = mmap(NULL, d_sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    d_ring_fd, IORING_OFF_SQ_RING);
+    if (d_sq_map == MAP_FAILED) {
+        return errno;
+    }
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        d_cq_map = d_sq_map;
+    } else {
+        d_cq_map = mmap(NULL, d_cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        d_ring_fd, IORING_OFF_CQ_RING);
+        if (d_cq_map == MAP_FAILED) {
+            return errno;
+        }
+    }
+    d_sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    void *sqes = mmap(NULL, d_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      d_ring_fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        return errno;
+    }
+    d_sqes = static_cast<struct io_uring_sqe *>(sqes);
+    auto sq = static_cast<uint8_t *>(d_sq_map);
+    d_sq_head = reinterpret_cast<unsigned *>(sq + p.sq_off.head);
+    d_sq_tail = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+    d_sq_mask = reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+    d_sq_array = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+    auto cq = static_cast<uint8_t *>(d_cq_map);
+    d_cq_head = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+    d_cq_tail = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+    d_cq_mask = reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+    d_cqes = cq + p.cq_off.cqes;
+
+    // Register the provided buffer ring (page aligned), and fill it
+    d_buf_ring_size = Buffer_count * sizeof(struct io_uring_buf);
+    void *br = mmap(NULL, d_buf_ring_size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (br == MAP_FAILED) {
+        return errno;
+    }
+    d_buf_ring = static_cast<struct io_uring_buf_ring *>(br);
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = reinterpret_cast<uint64_t>(d_buf_ring);
+    reg.ring_entries = Buffer_count;
+    reg.bgid = 0;
+    if (io_uring_register(d_ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+        return errno;
+    }
+    for (int i = 0; i < Buffer_count; i++) {
+        struct io_uring_buf *buf = buf_entry(d_buf_ring, d_buf_tail++ & (Buffer_count - 1));
+        buf->addr = reinterpret_cast<uint64_t>(&d_buffers[i * d_buffer_size]);
+        buf->len = d_buffer_size;
+        buf->bid = i;
+    }
+    __atomic_store_n(&d_buf_ring->tail, d_buf_tail, __ATOMIC_RELEASE);
+
+    d_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (d_event_fd == -1) {
+        return errno;
+    }
+    arm_wakeup();
+    arm_recv();
+    if (submit() < 0) {
+        return errno;
+    }
+    return 0;
+}
+
+struct io_uring_sqe *uring_rx::get_sqe()
+{
+    unsigned const index = (*d_sq_tail + d_sq_pending) & *d_sq_mask;
+    struct io_uring_sqe *sqe = &d_sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    d_sq_array[index] = index;
+    d_sq_pending++;
+    return sqe;
+}
+
+// Multishot recvmsg into the provided buffers
+void uring_rx::arm_recv()
+{
+    struct io_uring_sqe *sqe = get_sqe();
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = d_fd;
+    sqe->addr = reinterpret_cast<uint64_t>(&d_msg);
+    sqe->len = 1;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = 0;
+    sqe->user_data = Recv_tag;
+    d_recv_armed = true;
+}
+
+// Multishot poll on the wakeup eventfd
+void uring_rx::arm_wakeup()
+{
+    struct io_uring_sqe *sqe = get_sqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = d_event_fd;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->poll32_events = POLLIN;
+    sqe->user_data = Wakeup_tag;
+    d_wakeup_armed = true;
+}
+
+// Restart whatever multishot request has ended
+void uring_rx::rearm()
+{
+    if (!d_recv_armed) {
+        arm_recv();
+    }
+    if (!d_wakeup_armed) {
+        arm_wakeup();
+    }
+    if (d_sq_pending > 0) {
+        submit();
+    }
+}
+
+int uring_rx::submit()
+{
+    unsigned const n = d_sq_pending;
+    __atomic_store_n(d_sq_tail, *d_sq_tail + n, __ATOMIC_RELEASE);
+    d_sq_pending = 0;
+    return io_uring_enter(d_ring_fd, n, 0, 0, NULL, 0);
+}
+
+// Give the buffers of the datagrams handed out last time back to the kernel
+void uring_rx::recycle()
+{
+    if (d_count == 0) {
+        return;
+    }
+    for (int i = 0; i < d_count; i++) {
+        uint16_t const bid = d_packets[i].bid;
+        struct io_uring_buf *buf = buf_entry(d_buf_ring, d_buf_tail++ & (Buffer_count - 1));
+        buf->addr = reinterpret_cast<uint64_t>(&d_buffers[bid * d_buffer_size]);
+        buf->len = d_buffer_size;
+        buf->bid = bid;
+    }
+    __atomic_store_n(&d_buf_ring->tail, d_buf_tail, __ATOMIC_RELEASE);
+}
+
+// Collect the completions queued so far (no system call)
+// Returns the number of completions seen
+int uring_rx::harvest()
+{
+    unsigned head = *d_cq_head;
+    unsigned const tail = __atomic_load_n(d_cq_tail, __ATOMIC_ACQUIRE);
+    int seen = 0;
+    bool returned = false;
+    auto cqes = static_cast<struct io_uring_cqe *>(d_cqes);
+    for (; head != tail && d_count < d_batch_size; head++, seen++) {
+        struct io_uring_cqe const *cqe = &cqes[head & *d_cq_mask];
+        bool const more = cqe->flags & IORING_CQE_F_MORE;
+        if (cqe->user_data == Wakeup_tag) {
+            uint64_t value;
+            if (read(d_event_fd, &value, sizeof(value)) < 0) {
+                // already cleared
+            }
+            d_woken = true;
+            d_wakeup_armed = more;
+            continue;
+        }
+        if (cqe->user_data != Recv_tag) {
+            continue; // cancel request
+        }
+        d_recv_armed = more;
+        if (cqe->res < 0) {
+            if (cqe->res == -ENOBUFS) {
+                d_overruns++; // all buffers in use: rearmed on the next receive()
+            } else if (cqe->res != -ECANCELED && !d_recv_failing) {
+                d_logger->warn("io_uring recvmsg failed: {}", strerror(-cqe->res));
+                d_recv_failing = true;
+            }
+            continue;
+        }
+        d_recv_failing = false;
+        if (!(cqe->flags & IORING_CQE_F_BUFFER)) {
+            continue;
+        }
+        uint16_t const bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+        uint8_t *buf = &d_buffers[bid * d_buffer_size];
+        auto out = reinterpret_cast<struct io_uring_recvmsg_out const *>(buf);
+        uint8_t const *name = buf + sizeof(*out);
+        uint8_t const *control = name + d_msg.msg_namelen;
+        uint8_t const *payload = control + d_msg.msg_controllen;
+        if ((out->flags & MSG_TRUNC) ||
+            payload + out->payloadlen > buf + cqe->res) {
+            // Too big: give the buffer straight back
+            struct io_uring_buf *b = buf_entry(d_buf_ring, d_buf_tail++ & (Buffer_count - 1));
+            b->addr = reinterpret_cast<uint64_t>(buf);
+            b->len = d_buffer_size;
+            b->bid = bid;
+            returned = true;
+            continue;
+        }
+        packet& p = d_packets[d_count++];
+        p.data = payload;
+        p.len = out->payloadlen;
+        p.sender = reinterpret_cast<struct sockaddr const *>(name);
+        p.bid = bid;
+        p.kernel_ns = 0;
+        if (d_timestamps && out->controllen > 0) {
+            struct msghdr hdr;
+            memset(&hdr, 0, sizeof(hdr));
+            hdr.msg_control = const_cast<uint8_t *>(control);
+            hdr.msg_controllen = out->controllen;
+            for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr); cmsg != NULL;
+                 cmsg = CMSG_NXTHDR(&hdr, cmsg)) {
+                if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+                    struct timespec ts;
+                    memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+                    p.kernel_ns = int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+                }
+            }
+        }
+    }
+    __atomic_store_n(d_cq_head, head, __ATOMIC_RELEASE);
+    if (returned) {
+        __atomic_store_n(&d_buf_ring->tail, d_buf_tail, __ATOMIC_RELEASE);
+    }
+    return seen;
+}
+
+int uring_rx::receive(int timeout_ms)
+{
+    recycle();
+    d_count = 0;
+    d_woken = false;
+
+    rearm();
+    harvest();
+    if (d_count == 0 && !d_recv_armed) {
+        // The multishot recvmsg just ended (all the buffers were in use):
+        // restart it now that they are back, to pick up what's queued
+        rearm();
+        harvest();
+    }
+    if (d_count == 0 && timeout_ms != 0 && !d_woken) {
+        // Nothing queued: sleep until a completion (or the timeout)
+        struct __kernel_timespec ts;
+        struct io_uring_getevents_arg arg;
+        memset(&arg, 0, sizeof(arg));
+        if (timeout_ms > 0) {
+            ts.tv_sec = timeout_ms / 1000;
+            ts.tv_nsec = (timeout_ms % 1000) * 1000000LL;
+            arg.ts = reinterpret_cast<uint64_t>(&ts);
+        }
+        io_uring_enter(d_ring_fd, 0, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+                       &arg, sizeof(arg));
+        harvest();
+    }
+    if (d_count > 0) {
+        d_recv_ns = rx_batch::now_ns();
+    }
+    return d_count;
+}
+
+void uring_rx::wakeup()
+{
+    uint64_t const one = 1;
+    if (write(d_event_fd, &one, sizeof(one)) < 0) {
+        // counter saturated: a wakeup is pending anyway
+    }
+}
+
+} // namespace rtp
+} // namespace gr
@@ -0,0 +1,125 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 Franco Venturi.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_RTP_URING_RX_H
+#define INCLUDED_RTP_URING_RX_H
+
+#include <gnuradio/logger.h>
+
+#include <sys/socket.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct io_uring_sqe;
+struct io_uring_buf_ring;
+
+namespace gr {
+namespace rtp {
+
+// Multicast input through io_uring (Linux 6.0 or later)
+// A single multishot recvmsg keeps receiving into a ring of provided buffers,
+// so while packets keep coming there is no system call per packet, and none
+// at all when completions are already queued. receive() hands out the
+// datagrams in place (pointers into the buffers), which go back to the
+// kernel with the next receive(). A receiver blocked in receive() with no
+// timeout returns when another thread calls wakeup().
+class uring_rx
+{
+public:
+    static int const Buffer_count = 1024;   // provided buffers (power of 2)
+    static int const Payload_size = 9000;   // allow for jumbograms
+
+    // Set up the ring for fd; batch_size = max datagrams per receive()
+    // Returns nullptr if io_uring (or multishot recvmsg) isn't available:
+    // the caller keeps reading fd as usual then
+    static std::unique_ptr<uring_rx> open(int fd,
+                                          int batch_size,
+                                          bool timestamps,
+                                          const gr::logger_ptr& logger);
+    ~uring_rx();
+
+    // Return the previous batch of buffers and take the datagrams received since
+    // Waits up to timeout_ms (-1 = until a datagram arrives or wakeup() is called)
+    // Returns the number of datagrams, 0 if none are available
+    int receive(int timeout_ms);
+
+    // Make a blocked receive() return (thread safe)
+    void wakeup();
+
+    uint8_t const *data(int i) const { return d_packets[i].data; }
+    int len(int i) const { return d_packets[i].len; }
+    struct sockaddr const *sender(int i) const { return d_packets[i].sender; }
+    // Kernel receive time of datagram i in ns since the epoch (0 = unknown)
+    int64_t kernel_ns(int i) const { return d_packets[i].kernel_ns; }
+    // Time the last receive() returned, in ns since the epoch
+    int64_t recv_ns() const { return d_recv_ns; }
+
+    // Number of times all the buffers were in use (datagrams then wait
+    // in the socket buffer until the receive is restarted)
+    uint64_t overruns() const { return d_overruns; }
+
+private:
+    struct packet {
+        uint8_t const *data;
+        int len;
+        int64_t kernel_ns;
+        struct sockaddr const *sender;
+        uint16_t bid; // buffer to give back
+    };
+
+    uring_rx(int fd, int batch_size, bool timestamps, const gr::logger_ptr& logger);
+    int setup();
+    struct io_uring_sqe *get_sqe();
+    void arm_recv();
+    void arm_wakeup();
+    void rearm();
+    int submit();
+    int harvest();
+    void recycle();
+
+    gr::logger_ptr d_logger;
+    int const d_fd;      // socket
+    int const d_batch_size;
+    bool const d_timestamps;
+    int const d_buffer_size;
+    int d_ring_fd;
+    int d_event_fd;      // wakeup()
+
+    // submission and completion queues (shared with the kernel)
+    void *d_sq_map;
+    size_t d_sq_map_size;
+    void *d_cq_map;
+    size_t d_cq_map_size;
+    struct io_uring_sqe *d_sqes;
+    size_t d_sqes_size;
+    unsigned *d_sq_head, *d_sq_tail, *d_sq_mask, *d_sq_array;
+    unsigned *d_cq_head, *d_cq_tail, *d_cq_mask;
+    void *d_cqes;
+    unsigned d_sq_pending; // prepared, not submitted yet
+
+    // provided buffers
+    struct io_uring_buf_ring *d_buf_ring;
+    size_t d_buf_ring_size;
+    uint16_t d_buf_tail;
+    std::vector<uint8_t> d_buffers;
+    struct msghdr d_msg; // layout of the multishot recvmsg buffers
+
+    bool d_recv_armed;
+    bool d_wakeup_armed;
+    bool d_woken;
+    std::vector<packet> d_packets;
+    int d_count;
+    int64_t d_recv_ns;
+    uint64_t d_overruns;
+    bool d_recv_failing; // reported the error already
+};
+
+} // namespace rtp
+} // namespace gr
+
+#endif /* INCLUDED_RTP_URING_RX_H */
@@ -0,0 +1,45 @@
+/*
+ * Copyright 2023 Free Software Foundation, Inc.
+ *
+ * This file is part of GNU Radio
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ */
+#include "pydoc_macros.h"
+#define D(...) DOC(gr, rtp, __VA_ARGS__)
+/*
+  This file contains placeholders for docstrings for the Python bindings.
+  Do not edit! These were automatically extracted during the binding process
+  and will be overwritten during the build process
+ */
+
+
+
+ static const char *__doc_gr_rtp_sink = R"doc()doc";
+
+
+ static const char *__doc_gr_rtp_sink_sink = R"doc()doc";
+
+
+ static const char *__doc_gr_rtp_sink_make = R"doc()doc";
+
+
+ static const char *__doc_gr_rtp_sink_get_ssrc = R"doc()doc";
+
+
+ static const char *__doc_gr_rtp_sink_get_payload_type = R"doc()doc";
+
+
+ static const char *__doc_gr_rtp_sink_get_samples_per_packet = R"doc()doc";
+
+
+ static const char *__doc_gr_rtp_sink_get_batch_size = R"doc()doc";
+
+
+ static const char *__doc_gr_rtp_sink_get_packets = R"doc()doc";
+
+
+ static const char *__doc_gr_rtp_sink_get_dropped = R"doc()doc";
+
+
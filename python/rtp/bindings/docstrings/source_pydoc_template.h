@@ -37,3 +37,66 @@
  static const char *__doc_gr_rtp_source_get_ssrc = R"doc()doc";
 
 
+ static const char *__doc_gr_rtp_source_get_batch_size = R"doc()doc";
+
+
+ static const char *__doc_gr_rtp_source_get_ring_depth = R"doc()doc";
+
+
+ static const char *__doc_gr_rtp_source_get_ring_overruns = R"doc()doc";
+
+
+ static const char *__doc_gr_rtp_source_get_ring_high_water = R"doc()doc";
+
+
+ static const char *__doc_gr_rtp_source_get_truncated = R"doc()doc";
+
+
+ static const char *__doc_gr_rtp_source_get_jitter_depth = R"doc()doc";
+
+
+ static const char *__doc_gr_rtp_source_get_packets = R"doc()doc";
+
+
+static const char *__doc_gr_rtp_source_get_bytes = R"doc()doc";
+
+
+static const char *__doc_gr_rtp_source_get_drops = R"doc()doc";
+
+
+static const char *__doc_gr_rtp_source_get_dupes = R"doc()doc";
+
+
+static const char *__doc_gr_rtp_source_get_zero_filled = R"doc()doc";
+
+
+static const char *__doc_gr_rtp_source_get_reorder_depth = R"doc()doc";
+
+
+static const char *__doc_gr_rtp_source_get_reordered = R"doc()doc";
+
+
+ static const char *__doc_gr_rtp_source_get_late = R"doc()doc";
+
+
+ static const char *__doc_gr_rtp_source_get_lost = R"doc()doc";
+
+
+ static const char *__doc_gr_rtp_source_get_kernel_latency = R"doc()doc";
+
+
+ static const char *__doc_gr_rtp_source_get_output_latency = R"doc()doc";
+
+
+ static const char *__doc_gr_rtp_source_reset_latency = R"doc()doc";
+
+
+ static const char *__doc_gr_rtp_source_get_interarrival_jitter = R"doc()doc";
+
+
+static const char *__doc_gr_rtp_source_get_samp_rate = R"doc()doc";
+
+
+static const char *__doc_gr_rtp_source_get_frequency = R"doc()doc";
+
+
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2023 Free Software Foundation, Inc.
+ *
+ * This file is part of GNU Radio
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ */
+
+/***********************************************************************************/
+/* This file is automatically generated using bindtool and can be manually edited  */
+/* The following lines can be configured to regenerate this file during cmake      */
+/* If manual edits are made, the following tags should be modified accordingly.    */
+/* BINDTOOL_GEN_AUTOMATIC(0)                                                       */
+/* BINDTOOL_USE_PYGCCXML(0)                                                        */
+/* BINDTOOL_HEADER_FILE(multi_source.h)                                        */
+/* BINDTOOL_HEADER_FILE_HASH(76c4a96c6944bc28070772d14d42d5b4)                     */
+/***********************************************************************************/
+
+#include <pybind11/complex.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+namespace py = pybind11;
+
+#include <gnuradio/rtp/multi_source.h>
+// pydoc.h is automatically generated in the build directory
+#include <multi_source_pydoc.h>
+
+template <typename T>
+void bind_multi_source_template(py::module& m, const char *classname)
+{
+    using multi_source = gr::rtp::multi_source<T>;
+
+    py::class_<multi_source, gr::block, gr::basic_block,
+        std::shared_ptr<multi_source>>(m, classname, D(multi_source))
+
+        .def(py::init(&multi_source::make),
+             py::arg("mcast_addresss"),
+             py::arg("ssrcs"),
+             py::arg("num_outputs") = 1,
+             py::arg("in_channels") = 1,
+             py::arg("quiet") = false,
+             py::arg("batch_size") = 16,
+             D(multi_source, make))
+
+
+        .def("get_channels", &multi_source::get_channels, D(multi_source, get_channels))
+
+
+        .def("get_ssrcs",
+             &multi_source::get_ssrcs,
+             D(multi_source, get_ssrcs))
+
+        ;
+}
+
+void bind_multi_source(py::module &m)
+{
+    bind_multi_source_template<gr_complex>(m, "multi_source_c");
+    bind_multi_source_template<float>(m, "multi_source_f");
+    bind_multi_source_template<std::int16_t>(m, "multi_source_s");
+}
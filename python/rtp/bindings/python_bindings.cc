@@ -21,6 +21,8 @@ namespace py = pybind11;
 // Please do not delete
 /**************************************/
 // BINDING_FUNCTION_PROTOTYPES(
+    void bind_multi_source(py::module& m);
+    void bind_sink(py::module& m);
     void bind_source(py::module& m);
 // ) END BINDING_FUNCTION_PROTOTYPES
 
@@ -50,6 +52,8 @@ PYBIND11_MODULE(rtp_python, m)
     // Please do not delete
     /**************************************/
     // BINDING_FUNCTION_CALLS(
+    bind_multi_source(m);
+    bind_sink(m);
     bind_source(m);
     // ) END BINDING_FUNCTION_CALLS
 }
\ No newline at end of file
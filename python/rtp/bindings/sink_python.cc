@@ -0,0 +1,87 @@
+/*
+ * Copyright 2023 Free Software Foundation, Inc.
+ *
+ * This file is part of GNU Radio
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ */
+
+/***********************************************************************************/
+/* This file is automatically generated using bindtool and can be manually edited  */
+/* The following lines can be configured to regenerate this file during cmake      */
+/* If manual edits are made, the following tags should be modified accordingly.    */
+/* BINDTOOL_GEN_AUTOMATIC(0)                                                       */
+/* BINDTOOL_USE_PYGCCXML(0)                                                        */
+/* BINDTOOL_HEADER_FILE(sink.h)                                        */
+/* BINDTOOL_HEADER_FILE_HASH(6db4ac4aaa38b768008fcd221c0ec1bf)                     */
+/***********************************************************************************/
+
+#include <pybind11/complex.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+namespace py = pybind11;
+
+#include <gnuradio/rtp/sink.h>
+// pydoc.h is automatically generated in the build directory
+#include <sink_pydoc.h>
+
+template <typename T>
+void bind_sink_template(py::module& m, const char *classname)
+{
+    using sink = gr::rtp::sink<T>;
+
+    py::class_<sink, gr::sync_block, gr::block, gr::basic_block,
+        std::shared_ptr<sink>>(m, classname, D(sink))
+
+        .def(py::init(&sink::make),
+             py::arg("mcast_address"),
+             py::arg("ssrc"),
+             py::arg("samp_rate"),
+             py::arg("in_channels") = 1,
+             py::arg("out_channels") = 1,
+             py::arg("samples_per_packet") = 0,
+             py::arg("ttl") = 1,
+             py::arg("batch_size") = 16,
+             D(sink, make))
+
+
+        .def("get_ssrc",
+             &sink::get_ssrc,
+             D(sink, get_ssrc))
+
+
+        .def("get_payload_type",
+             &sink::get_payload_type,
+             D(sink, get_payload_type))
+
+
+        .def("get_samples_per_packet",
+             &sink::get_samples_per_packet,
+             D(sink, get_samples_per_packet))
+
+
+        .def("get_batch_size",
+             &sink::get_batch_size,
+             D(sink, get_batch_size))
+
+
+        .def("get_packets",
+             &sink::get_packets,
+             D(sink, get_packets))
+
+
+        .def("get_dropped",
+             &sink::get_dropped,
+             D(sink, get_dropped))
+
+        ;
+}
+
+void bind_sink(py::module &m)
+{
+    bind_sink_template<gr_complex>(m, "sink_c");
+    bind_sink_template<float>(m, "sink_f");
+    bind_sink_template<std::int16_t>(m, "sink_s");
+}
@@ -14,7 +14,7 @@
 /* BINDTOOL_GEN_AUTOMATIC(0)                                                       */
 /* BINDTOOL_USE_PYGCCXML(0)                                                        */
 /* BINDTOOL_HEADER_FILE(source.h)                                        */
-/* BINDTOOL_HEADER_FILE_HASH(ef8b19d120ecba16aa0100548e088506)                     */
+/* BINDTOOL_HEADER_FILE_HASH(3b036b0c9ea1034cb6589212d5e62f1e)                     */
 /***********************************************************************************/
 
 #include <pybind11/complex.h>
@@ -41,6 +41,18 @@ void bind_source_template(py::module& m, const char *classname)
              py::arg("in_channels") = 1,
              py::arg("out_channels") = 1,
              py::arg("quiet") = false,
+             py::arg("batch_size") = 16,
+             py::arg("ring_depth") = 0,
+             py::arg("shared_socket") = false,
+             py::arg("jitter_packets") = 0,
+             py::arg("jitter_ms") = 0,
+             py::arg("latency_stats") = false,
+             py::arg("async_join") = false,
+             py::arg("zero_copy") = false,
+             py::arg("io_uring") = false,
+             py::arg("rtcp") = false,
+             py::arg("status_address") = "",
+             py::arg("stats_interval") = 1000,
              D(source, make))
 
 
@@ -62,6 +74,111 @@ void bind_source_template(py::module& m, const char *classname)
              &source::get_ssrc,
              D(source, get_ssrc))
 
+
+        .def("get_batch_size",
+             &source::get_batch_size,
+             D(source, get_batch_size))
+
+
+        .def("get_ring_depth",
+             &source::get_ring_depth,
+             D(source, get_ring_depth))
+
+
+        .def("get_ring_overruns",
+             &source::get_ring_overruns,
+             D(source, get_ring_overruns))
+
+
+        .def("get_ring_high_water",
+             &source::get_ring_high_water,
+             D(source, get_ring_high_water))
+
+
+        .def("get_truncated",
+             &source::get_truncated,
+             D(source, get_truncated))
+
+
+        .def("get_jitter_depth",
+             &source::get_jitter_depth,
+             D(source, get_jitter_depth))
+
+
+        .def("get_packets",
+             &source::get_packets,
+             D(source, get_packets))
+
+
+        .def("get_bytes",
+             &source::get_bytes,
+             D(source, get_bytes))
+
+
+        .def("get_drops",
+             &source::get_drops,
+             D(source, get_drops))
+
+
+        .def("get_dupes",
+             &source::get_dupes,
+             D(source, get_dupes))
+
+
+        .def("get_zero_filled",
+             &source::get_zero_filled,
+             D(source, get_zero_filled))
+
+
+        .def("get_reorder_depth",
+             &source::get_reorder_depth,
+             D(source, get_reorder_depth))
+
+
+        .def("get_reordered",
+             &source::get_reordered,
+             D(source, get_reordered))
+
+
+        .def("get_late",
+             &source::get_late,
+             D(source, get_late))
+
+
+        .def("get_lost",
+             &source::get_lost,
+             D(source, get_lost))
+
+
+        .def("get_kernel_latency",
+             &source::get_kernel_latency,
+             D(source, get_kernel_latency))
+
+
+        .def("get_output_latency",
+             &source::get_output_latency,
+             D(source, get_output_latency))
+
+
+        .def("reset_latency",
+             &source::reset_latency,
+             D(source, reset_latency))
+
+
+        .def("get_interarrival_jitter",
+             &source::get_interarrival_jitter,
+             D(source, get_interarrival_jitter))
+
+
+        .def("get_samp_rate",
+             &source::get_samp_rate,
+             D(source, get_samp_rate))
+
+
+        .def("get_frequency",
+             &source::get_frequency,
+             D(source, get_frequency))
+
         ;
 }
 
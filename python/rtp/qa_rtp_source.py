@@ -0,0 +1,110 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+#
+# Copyright 2023 Franco Venturi.
+#
+# SPDX-License-Identifier: GPL-3.0-or-later
+#
+
+import os
+import shutil
+import subprocess
+import time
+import unittest
+
+from gnuradio import gr, gr_unittest
+from gnuradio import blocks
+try:
+    from gnuradio.rtp import source_f
+except ImportError:
+    import sys
+    dirname, filename = os.path.split(os.path.abspath(__file__))
+    sys.path.append(os.path.join(dirname, "bindings"))
+    from gnuradio.rtp import source_f
+
+# rtp_generator sends the test streams on the loopback interface
+# (the build tree sets RTP_GENERATOR; otherwise look for it in the PATH)
+GENERATOR = os.environ.get("RTP_GENERATOR") or shutil.which("rtp_generator")
+
+SAMP_RATE = 48000
+FRAMES = 480          # per packet: 960 payload bytes of 16-bit mono
+SSRC = 1000
+SUSTAINED_SPEED = 20  # times real time the source must keep up with, losing nothing
+
+
+@unittest.skipUnless(GENERATOR and os.access(GENERATOR, os.X_OK),
+                     "rtp_generator not found")
+class qa_rtp_source(gr_unittest.TestCase):
+
+    # Every test runs with the direct read and with the receiver thread
+    RING_DEPTHS = (0, 1024)
+
+    # Receive seconds of signal sent at speed times real time (to port on
+    # the loopback interface), with the extra generator options
+    # Returns the output samples and the source block
+    def receive(self, port, seconds, speed=1, options=(), ring_depth=0):
+        target = "239.42.0.1:{},lo".format(port)
+        tb = gr.top_block()
+        src = source_f(target, SSRC, 1, 1, True, 16, ring_depth)
+        sink = blocks.vector_sink_f()
+        tb.connect(src, sink)
+        # the source joined the group when it was made: nothing is missed
+        tb.start()
+        subprocess.run([GENERATOR, "-q", "-r", str(SAMP_RATE), "-c", "1",
+                        "-b", str(2 * FRAMES), "-s", str(SSRC),
+                        "-x", str(speed), "-d", str(seconds)] + list(options) + [target],
+                       check=True, timeout=seconds / max(speed, 1) + 30)
+        # wait for the source to catch up with the last packet
+        expected = int(seconds * SAMP_RATE)
+        deadline = time.monotonic() + 5
+        while len(sink.data()) < expected and time.monotonic() < deadline:
+            time.sleep(0.01)
+        tb.stop()
+        tb.wait()
+        return sink.data(), src
+
+    # Run check(port, ring_depth) for each ring depth, on its own port
+    def for_ring_depths(self, port, check):
+        for i, ring_depth in enumerate(self.RING_DEPTHS):
+            with self.subTest(ring_depth=ring_depth):
+                check(port + 10 * i, ring_depth)
+
+    def test_001_sample_count(self):
+        def check(port, ring_depth):
+            data, src = self.receive(port, 1, ring_depth=ring_depth)
+            self.assertEqual(len(data), SAMP_RATE)
+            self.assertEqual(src.get_packets(), SAMP_RATE // FRAMES)
+            self.assertEqual(src.get_drops(), 0)
+            self.assertEqual(src.get_zero_filled(), 0)
+            # a half scale tone
+            self.assertAlmostEqual(max(data), 0.5, places=3)
+            self.assertAlmostEqual(min(data), -0.5, places=3)
+        self.for_ring_depths(5110, check)
+
+    def test_002_gap_zero_fill(self):
+        def check(port, ring_depth):
+            data, src = self.receive(port, 1, options=["-l", "10"], ring_depth=ring_depth)
+            # every lost packet between the first and the last is a packet of zeroes
+            self.assertEqual(len(data) % FRAMES, 0)
+            packets = [data[i:i + FRAMES] for i in range(0, len(data), FRAMES)]
+            gaps = sum(1 for p in packets if not any(p))
+            self.assertGreater(gaps, 0)
+            self.assertEqual(gaps + src.get_packets(), len(packets))
+            self.assertEqual(src.get_drops(), gaps)
+            self.assertEqual(src.get_zero_filled(), gaps * FRAMES)
+        self.for_ring_depths(5112, check)
+
+    def test_003_sustained_rate(self):
+        seconds = 5
+
+        def check(port, ring_depth):
+            data, src = self.receive(port, seconds, speed=SUSTAINED_SPEED,
+                                     ring_depth=ring_depth)
+            self.assertEqual(len(data), seconds * SAMP_RATE)
+            self.assertEqual(src.get_drops(), 0)
+            self.assertEqual(src.get_ring_overruns(), 0)
+        self.for_ring_depths(5114, check)
+
+
+if __name__ == '__main__':
+    gr_unittest.run(qa_rtp_source)